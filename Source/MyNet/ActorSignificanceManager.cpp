@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActorSignificanceManager.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "Bomb.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "EngineUtils.h"
+
+AActorSignificanceManager::AActorSignificanceManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	// Every machine ranks for its own view points
+	SetReplicates(false);
+}
+
+void AActorSignificanceManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeToUpdate -= DeltaTime;
+	if (TimeToUpdate <= 0.f)
+	{
+		UpdateSignificance();
+		TimeToUpdate = UpdateInterval;
+	}
+
+	// The throttled tick functions would all have run this frame
+	const float TicksSaved = FMath::Max(0.f, NumThrottledTicks - DeltaTime * ThrottledTickRate);
+	const float NetUpdatesSaved = NetUpdatesSavedPerSecond * DeltaTime;
+
+	INC_FLOAT_STAT_BY(STAT_MyNet_TicksSaved, TicksSaved);
+	INC_FLOAT_STAT_BY(STAT_MyNet_NetUpdatesSaved, NetUpdatesSaved);
+
+	TotalTicksSaved += TicksSaved;
+	TotalNetUpdatesSaved += NetUpdatesSaved;
+	NumFrames++;
+}
+
+void AActorSignificanceManager::UpdateSignificance()
+{
+	if (Buckets.Num() == 0)
+	{
+		return;
+	}
+
+	// The server has every player controller, a client only its local ones
+	ViewPoints.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewPoints.Emplace(PlayerController, ViewLocation);
+		}
+	}
+
+	NumThrottledTicks = 0;
+	ThrottledTickRate = 0.f;
+	NetUpdatesSavedPerSecond = 0.f;
+
+	BucketCounts.Reset();
+	BucketCounts.SetNumZeroed(Buckets.Num());
+
+	for (TActorIterator<AMyNetCharacter> It(GetWorld()); It; ++It)
+	{
+		ApplyBucket(*It, It->GetCharacterMovement(), It->GetBaseNetUpdateFrequency());
+	}
+
+	for (TActorIterator<ABomb> It(GetWorld()); It; ++It)
+	{
+		ApplyBucket(*It, It->GetProjectileMovement(), It->GetBaseNetUpdateFrequency());
+	}
+}
+
+void AActorSignificanceManager::ApplyBucket(AActor* Actor, UMovementComponent* Movement, float BaseNetUpdateFrequency)
+{
+	if (Actor->IsPendingKill())
+	{
+		return;
+	}
+
+	// The characters of the local players always run at full rate, they are what the players see and control
+	const APawn* Pawn = Cast<APawn>(Actor);
+	const bool bPlayerPawn = Pawn && (Pawn->IsLocallyControlled() || Pawn->Role == ROLE_AutonomousProxy);
+
+	// On the server a player always views its own character, what matters is whether anybody else does.
+	// A client only has the view points of its own players
+	const bool bSkipOwnViewPoint = GetNetMode() != NM_Client;
+
+	float MinDistanceSquared = bPlayerPawn ? 0.f : BIG_NUMBER;
+	if (!bPlayerPawn)
+	{
+		for (const TPair<const APlayerController*, FVector>& ViewPoint : ViewPoints)
+		{
+			if (!bSkipOwnViewPoint || ViewPoint.Key->GetPawn() != Actor)
+			{
+				MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(ViewPoint.Value, Actor->GetActorLocation()));
+			}
+		}
+	}
+
+	const int32 BucketIndex = GetBucketIndex(MinDistanceSquared);
+	const FSignificanceBucket& Bucket = Buckets[BucketIndex];
+	const AActor* Defaults = Actor->GetClass()->GetDefaultObject<AActor>();
+	BucketCounts[BucketIndex]++;
+
+	if (Actor->PrimaryActorTick.bCanEverTick)
+	{
+		const float Interval = FMath::Max(Defaults->PrimaryActorTick.TickInterval, Bucket.ActorTickInterval);
+		Actor->SetActorTickInterval(Interval);
+		CountTickInterval(Interval);
+	}
+
+	// Only the simulated proxies, the authority and the owning client move for real
+	if (Movement && Actor->Role == ROLE_SimulatedProxy)
+	{
+		Movement->SetComponentTickInterval(Bucket.MovementTickInterval);
+		CountTickInterval(Bucket.MovementTickInterval);
+	}
+
+	// Scaled from the rate the actor started with, so the previous ranking doesn't compound
+	if (Actor->Role == ROLE_Authority && Actor->GetIsReplicated() && BaseNetUpdateFrequency > 0.f)
+	{
+		const float NetUpdateFrequency = FMath::Max(BaseNetUpdateFrequency * Bucket.NetUpdateScale, Actor->MinNetUpdateFrequency);
+		NetUpdatesSavedPerSecond += FMath::Max(0.f, BaseNetUpdateFrequency - NetUpdateFrequency);
+		Actor->NetUpdateFrequency = NetUpdateFrequency;
+	}
+}
+
+int32 AActorSignificanceManager::GetBucketIndex(float DistanceSquared) const
+{
+	int32 BucketIndex = 0;
+	while (BucketIndex < Buckets.Num() - 1 && DistanceSquared > FMath::Square(Buckets[BucketIndex].MaxDistance))
+	{
+		BucketIndex++;
+	}
+
+	return BucketIndex;
+}
+
+float AActorSignificanceManager::ScaleNetPriority(float Priority, const AActor* Actor, const FVector& ViewLocation) const
+{
+	if (Buckets.Num() == 0)
+	{
+		return Priority;
+	}
+
+	// Per connection, the actor keeps its full priority for the players close to it
+	const int32 BucketIndex = GetBucketIndex(FVector::DistSquared(ViewLocation, Actor->GetActorLocation()));
+	if (BucketIndex > 0)
+	{
+		INC_DWORD_STAT(STAT_MyNet_NetPrioritiesLowered);
+		TotalLoweredPriorities++;
+	}
+
+	return Priority * Buckets[BucketIndex].NetPriorityScale;
+}
+
+void AActorSignificanceManager::CountTickInterval(float Interval)
+{
+	if (Interval > 0.f)
+	{
+		NumThrottledTicks++;
+		ThrottledTickRate += 1.f / Interval;
+	}
+}
+
+void AActorSignificanceManager::LogStats() const
+{
+	UE_LOG(LogMyNet, Log, TEXT("%s: %.2f ticks saved, %.2f net updates saved and %.2f net priorities lowered per frame over %d frames"),
+		*GetName(), NumFrames > 0 ? TotalTicksSaved / NumFrames : 0.0, NumFrames > 0 ? TotalNetUpdatesSaved / NumFrames : 0.0,
+		NumFrames > 0 ? (double)TotalLoweredPriorities / NumFrames : 0.0, NumFrames);
+	UE_LOG(LogMyNet, Log, TEXT("  net updates: %.1f per second saved by the last ranking"), NetUpdatesSavedPerSecond);
+
+	for (int32 Index = 0; Index < BucketCounts.Num(); Index++)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("  bucket %d (up to %.0f): %d actors"), Index, Buckets[Index].MaxDistance, BucketCounts[Index]);
+	}
+}
+
+static FAutoConsoleCommandWithWorld SignificanceStatsCmd(
+	TEXT("mynet.SignificanceStats"),
+	TEXT("Logs the actors per significance bucket, the ticks and net updates saved and the net priorities lowered"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AActorSignificanceManager> It(World); It; ++It)
+		{
+			It->LogStats();
+		}
+	}));
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "ActorSignificanceManager.generated.h"
+
+class UMovementComponent;
+class APlayerController;
+
+/** How often the actors of a distance band tick and replicate */
+USTRUCT()
+struct FSignificanceBucket
+{
+	GENERATED_BODY()
+
+	/** Actors up to this far from the closest view point fall in this bucket */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float MaxDistance = 0.f;
+
+	/** Seconds between two actor ticks, 0 for every frame */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float ActorTickInterval = 0.f;
+
+	/** Seconds between two movement ticks of the simulated proxies, 0 for every frame */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float MovementTickInterval = 0.f;
+
+	/** Fraction of its base NetUpdateFrequency an actor replicates at */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float NetUpdateScale = 1.f;
+
+	/** Scales the net priority of an actor for a connection viewing it from this far */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float NetPriorityScale = 1.f;
+};
+
+/**
+* Throttles the characters and bombs by their distance to the closest player view point.
+* A few times per second every actor is put in a bucket of Buckets, which sets its tick interval and
+* the tick interval of its movement component on simulated proxies and, on the server, its net update
+* frequency as a fraction of the one it had at BeginPlay, see GetBaseNetUpdateFrequency. Locally controlled and autonomous
+* characters are never throttled. On the server the view point of the player controlling a character
+* doesn't count for it, or the server would never throttle a remote player.
+* On the server the characters and bombs also scale their net priority for every connection by the
+* bucket of their distance to its view point, see ScaleNetPriority.
+*
+* The server has one for all the view points, every client one for its local players.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AActorSignificanceManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AActorSignificanceManager();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Logs the number of actors per bucket and what was saved so far */
+	void LogStats() const;
+
+	/** Returns the net priority of an actor for a connection viewing it from ViewLocation. Server */
+	float ScaleNetPriority(float Priority, const AActor* Actor, const FVector& ViewLocation) const;
+
+protected:
+	/** Seconds between two rankings */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float UpdateInterval = 0.25f;
+
+	/** Distance bands, closest first. Actors past the last one use the last one */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	TArray<FSignificanceBucket> Buckets;
+
+private:
+	/** Ranks all the characters and bombs and applies their buckets */
+	void UpdateSignificance();
+
+	/** Puts an actor in the bucket of its distance */
+	void ApplyBucket(AActor* Actor, UMovementComponent* Movement, float BaseNetUpdateFrequency);
+
+	/** Returns the bucket of a squared distance */
+	int32 GetBucketIndex(float DistanceSquared) const;
+
+	/** Adds a tick function running every Interval seconds to the savings */
+	void CountTickInterval(float Interval);
+
+	float TimeToUpdate = 0.f;
+
+	/** Tick functions slowed down by the last ranking, and how many times per second they still run */
+	int32 NumThrottledTicks = 0;
+	float ThrottledTickRate = 0.f;
+
+	/** Net updates per second saved by the last ranking */
+	float NetUpdatesSavedPerSecond = 0.f;
+
+	/** Actors per bucket in the last ranking */
+	TArray<int32> BucketCounts;
+
+	/** Since the start */
+	double TotalTicksSaved = 0.0;
+	double TotalNetUpdatesSaved = 0.0;
+	int32 NumFrames = 0;
+
+	/** Net priorities lowered since the start */
+	mutable int64 TotalLoweredPriorities = 0;
+
+	/** The view points and their players. Scratch array, kept to avoid allocating each ranking */
+	TArray<TPair<const APlayerController*, FVector>> ViewPoints;
+};
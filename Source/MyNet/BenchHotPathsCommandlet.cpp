@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BenchHotPathsCommandlet.h"
+#include "MyNet.h"
+#include "HotPathBenchmark.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+UBenchHotPathsCommandlet::UBenchHotPathsCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBenchHotPathsCommandlet::Main(const FString& Params)
+{
+	const TCHAR* ParamsStr = *Params;
+
+	int32 NumSamples = 200;
+	float Threshold = 1.25f;
+	FParse::Value(ParamsStr, TEXT("Samples="), NumSamples);
+	FParse::Value(ParamsStr, TEXT("Threshold="), Threshold);
+
+	// An empty server world with the game mode and its managers
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BenchHotPaths"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+
+	TArray<FHotPathResult> Results;
+	FHotPathBenchmark::RunAll(World, NumSamples, Results);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	if (Results.Num() == 0)
+	{
+		UE_LOG(LogMyNet, Error, TEXT("BenchHotPaths: nothing was measured"));
+		return 1;
+	}
+
+	if (FParse::Param(ParamsStr, TEXT("WriteBaseline")))
+	{
+		if (!FHotPathBenchmark::WriteBaseline(Results))
+		{
+			UE_LOG(LogMyNet, Error, TEXT("BenchHotPaths: couldn't write the baseline to %s"), *FHotPathBenchmark::GetBaselinePath());
+			return 1;
+		}
+
+		UE_LOG(LogMyNet, Display, TEXT("BenchHotPaths: wrote the baseline of %d paths to %s"), Results.Num(), *FHotPathBenchmark::GetBaselinePath());
+		return 0;
+	}
+
+	const int32 NumFailures = FHotPathBenchmark::CompareWithBaseline(Results, Threshold);
+	if (NumFailures > 0)
+	{
+		UE_LOG(LogMyNet, Error, TEXT("BenchHotPaths: %d of %d paths are over %.2fx the baseline or have none, record one with -WriteBaseline on the reference machine"),
+			NumFailures, Results.Num(), Threshold);
+		return 1;
+	}
+
+	UE_LOG(LogMyNet, Display, TEXT("BenchHotPaths: %d paths within %.2fx the baseline"), Results.Num(), Threshold);
+	return 0;
+}
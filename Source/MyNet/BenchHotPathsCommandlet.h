@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BenchHotPathsCommandlet.generated.h"
+
+/**
+* Runs FHotPathBenchmark headless in an empty game world and fails if a path regressed or has no baseline.
+* With -WriteBaseline the results become Config/HotPathBaseline.csv instead, run it on the reference machine
+* and check the file in whenever a path is added or legitimately changes speed.
+*
+* UE4Editor-Cmd MyNet.uproject -run=BenchHotPaths -nullrhi [-Samples=200] [-Threshold=1.25] [-WriteBaseline]
+*/
+UCLASS()
+class UBenchHotPathsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBenchHotPathsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
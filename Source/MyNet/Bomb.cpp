@@ -3,14 +3,29 @@
 
 #include "Bomb.h"
 #include "MyNet.h"
+#include "BombPool.h"
+#include "ExplosionManager.h"
+#include "BombScheduler.h"
+#include "BombIntegrator.h"
+#include "CosmeticEventManager.h"
+#include "MyNetGameMode.h"
+#include "MyNetCharacter.h"
+#include "LoadTestRecorder.h"
+#include "MyNetProfiler.h"
+#include "StartupPreloader.h"
+#include "MatchManager.h"
+#include "MatchEventLog.h"
+#include "ActorSignificanceManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "GameFramework/GameStateBase.h"
 
 
 // Sets default values
 ABomb::ABomb()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Nothing to do every frame, the projectile movement ticks on its own and the fuse runs on the scheduler
+	PrimaryActorTick.bCanEverTick = false;
 
 	SphereComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
 	SetRootComponent(SphereComp);
@@ -25,6 +40,10 @@ ABomb::ABomb()
 	// for thi actor, we need to mark it as true
 	SetReplicates(true);
 
+	TimerNode.Bomb = this;
+
+	bLeanServer = IsLeanServer();
+
 }
 
 // Called when the game starts or when spawned
@@ -34,14 +53,62 @@ void ABomb::BeginPlay()
 
 	// register that funciton that will be calles in any bounce event
 	ProjectileMovementComp->OnProjectileBounce.AddDynamic(this, &ABomb::OnProjectileBounce);
+
+	// Remember the original look so a reused bomb can be reverted
+	if (!bLeanServer)
+	{
+		DefaultMaterial = SM->GetMaterial(0);
+	}
+
+	if (Role == ROLE_Authority && !bIsCosmeticProxy)
+	{
+		// Clients will simulate the flight from the launch state instead
+		SetReplicateMovement(!bReplicateLaunchOnly);
+
+		// Bombs are small and short lived, only the players that get shown their explosion need them
+		AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+		ACosmeticEventManager* CosmeticEventManager = GameMode ? GameMode->GetCosmeticEventManager() : nullptr;
+		NetCullDistanceSquared = FMath::Square(CosmeticEventManager ? CosmeticEventManager->GetEventRadius() : ExplosionRadius * NetCullRadiusScale);
+
+		// The significance manager scales this, not whatever it set last
+		BaseNetUpdateFrequency = NetUpdateFrequency;
+
+		InitLaunchState();
+		UpdateBombCounters();
+
+		// Hand the flight over to the integrator right away
+		ABombIntegrator* Integrator = GetIntegrator();
+		if (Integrator && Integrator->IsEnabled())
+		{
+			StartProjectile(ProjectileMovementComp->Velocity);
+		}
+	}
 	
 }
 
-// Called every frame
-void ABomb::Tick(float DeltaTime)
+void ABomb::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	UpdateBombCounters(true);
 
+	// The scheduler must not keep a pointer to a dead bomb
+	if (TimerNode.IsScheduled())
+	{
+		if (ABombScheduler* Scheduler = GetScheduler())
+		{
+			Scheduler->Cancel(TimerNode);
+		}
+	}
+
+	// Same for the integrator
+	if (BatchIndex != INDEX_NONE)
+	{
+		if (ABombIntegrator* Integrator = GetIntegrator())
+		{
+			Integrator->RemoveBomb(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABomb::GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const
@@ -50,16 +117,64 @@ void ABomb::GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetim
 
 	// Tell the engine that we will wish to replicate the bIsArmed variable
 	DOREPLIFETIME(ABomb, bIsArmed);
+	DOREPLIFETIME(ABomb, LaunchState);
+	DOREPLIFETIME(ABomb, Correction);
+}
+
+void ABomb::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// The state only changes on launch, bounce and reset, all of which mark it
+	const bool bReplicateState = ReplicationDirty.Consume(this, 3);
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE(ABomb, bIsArmed, bReplicateState);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(ABomb, LaunchState, bReplicateState);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(ABomb, Correction, bReplicateState);
+}
+
+bool ABomb::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	// Called for every channel the bomb got replicated on
+	ReplicationDirty.NotifyReplicated();
+
+	return Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+}
+
+float ABomb::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	const float Priority = Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	AActorSignificanceManager* SignificanceManager = GameMode ? GameMode->GetSignificanceManager() : nullptr;
+	return SignificanceManager ? SignificanceManager->ScaleNetPriority(Priority, this, ViewPos) : Priority;
 }
 
 void ABomb::ArmBomb()
 {
-	if (bIsArmed)
+	// The material only matters to whoever looks at the bomb
+	if (bLeanServer)
 	{
-		// Change the base color of static mesh to red
-		UMaterialInstanceDynamic* DynamicMAT = SM->CreateAndSetMaterialInstanceDynamic(0);
+		return;
+	}
 
-		DynamicMAT->SetVectorParameterValue(TEXT("Color"), FLinearColor::Red);
+	if (bIsArmed)
+	{
+		// Change the base color of static mesh to red.
+		// The material instance is kept around since pooled bombs get armed many times
+		if (!ArmedMaterial)
+		{
+			ArmedMaterial = SM->CreateAndSetMaterialInstanceDynamic(0);
+			ArmedMaterial->SetVectorParameterValue(TEXT("Color"), FLinearColor::Red);
+		}
+		else
+		{
+			SM->SetMaterial(0, ArmedMaterial);
+		}
+	}
+	else
+	{
+		SM->SetMaterial(0, DefaultMaterial);
 	}
 }
 
@@ -67,27 +182,53 @@ void ABomb::OnProjectileBounce(const FHitResult& ImpactResult, const FVector& Im
 {
 	// If the bomb is not armed and we have authority
 	// arm it and perform a delayed explosion
-	if (!bIsArmed && Role == ROLE_Authority)
+	if (!bIsArmed && Role == ROLE_Authority && !bIsCosmeticProxy)
 	{
 		bIsArmed = true;
+		ReplicationDirty.Mark();
 		ArmBomb();
+		UpdateBombCounters();
 
 		PerformDelayedExplosion(FuseTime);
 	}
+
+	// Bounces are where the client simulations drift, send them where the bomb really went
+	if (Role == ROLE_Authority && bReplicateLaunchOnly && !bIsCosmeticProxy)
+	{
+		Correction.Location = GetActorLocation();
+		Correction.Velocity = ProjectileMovementComp->Velocity;
+		Correction.ServerTime = GetServerWorldTime();
+		ReplicationDirty.Mark();
+	}
+
+	if (Role == ROLE_Authority && !bIsCosmeticProxy)
+	{
+		AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+		if (AMatchEventRecorder* EventRecorder = GameMode ? GameMode->GetEventRecorder() : nullptr)
+		{
+			EventRecorder->RecordBounce(this, ProjectileMovementComp->Velocity, bIsArmed);
+		}
+	}
 }
 
 void ABomb::OnRep_IsArmed()
 {
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
 	// Will get called when the bomb is armed
-	// from the authority client
-	if (bIsArmed)
-	{
-		ArmBomb();
-	}
+	// from the authority client, or disarmed when a pooled bomb is reset
+	ArmBomb();
 }
 
 void ABomb::PerformDelayedExplosion(float ExplosionDelay)
 {
+	// The scheduler drives all the fuses from one tick
+	if (ABombScheduler* Scheduler = GetScheduler())
+	{
+		Scheduler->Schedule(TimerNode, EBombPhase::Fuse, ExplosionDelay);
+		return;
+	}
+
 	FTimerHandle TimerHandle;
 	FTimerDelegate TimerDel;
 	TimerDel.BindUFunction(this, TEXT("Explode"));
@@ -97,32 +238,372 @@ void ABomb::PerformDelayedExplosion(float ExplosionDelay)
 
 void ABomb::Explode()
 {
-	SimulateExplosionFX();
+	FLoadTestScope LoadTestScope(ELoadTestScope::Bomb);
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_Explode, Explode);
+	FStartupCostScope StartupCostScope(GetWorld(), EStartupCost::Explosion);
 
-	// We won't use any specific damage in our case
-	TSubclassOf<UDamageType> DmgType;
-	// Do not ignore any actors
-	TArray<AActor*> IgnoreActors;
+	// Billed to the match of the thrower
+	const AMyNetCharacter* InstigatorCharacter = Cast<AMyNetCharacter>(Instigator);
+	FMatchCostScope MatchCostScope(InstigatorCharacter ? InstigatorCharacter->GetMatchId() : 0);
 
-	// This will eventually call the TakeDamage funciton that we have overriden in the Character class
-	UGameplayStatics::ApplyRadialDamage(GetWorld(), ExplosionDamage, GetActorLocation(), ExplosionRadius, DmgType, IgnoreActors, this, GetInstigatorController());
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+
+	// The actor may lag behind the batched flight, explode where the bomb really is
+	if (ABombIntegrator* Integrator = GameMode ? GameMode->GetBombIntegrator() : nullptr)
+	{
+		Integrator->SyncBomb(this);
+	}
+
+	// Only the players around get the effect, bundled with the other events of the frame
+	if (ACosmeticEventManager* CosmeticEventManager = GameMode ? GameMode->GetCosmeticEventManager() : nullptr)
+	{
+		CosmeticEventManager->AddEvent(ECosmeticEventType::Explosion, GetActorLocation(), ExplosionFX);
+	}
+	else
+	{
+		SimulateExplosionFX();
+	}
+
+	// Let the explosion manager resolve the damage together with the other explosions of this frame
+	if (AExplosionManager* ExplosionManager = GameMode ? GameMode->GetExplosionManager() : nullptr)
+	{
+		ExplosionManager->AddExplosion(GetActorLocation(), ExplosionRadius, ExplosionDamage, this, GetInstigatorController());
+	}
+	else
+	{
+		// We won't use any specific damage in our case
+		TSubclassOf<UDamageType> DmgType;
+		// Do not ignore any actors
+		TArray<AActor*> IgnoreActors;
+
+		MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RadialDamage, RadialDamage);
+
+		// This will eventually call the TakeDamage funciton that we have overriden in the Character class
+		UGameplayStatics::ApplyRadialDamage(GetWorld(), ExplosionDamage, GetActorLocation(), ExplosionRadius, DmgType, IgnoreActors, this, GetInstigatorController());
+	}
+
+	// Get rid of the actor after 0.3 seconds
+	if (ABombScheduler* Scheduler = GetScheduler())
+	{
+		Scheduler->Schedule(TimerNode, EBombPhase::Cleanup, 0.3f);
+		return;
+	}
 
 	FTimerHandle TimerHandle;
 	FTimerDelegate TimerDel;
 
-	TimerDel.BindLambda([&]()
-	{
-		Destroy();
-	});
+	// Bound to the object so the timer gets cleared along with the rest when the bomb is reset
+	TimerDel.BindUObject(this, &ABomb::FinishExplosion);
 
-	// Destroy actor after 0.3 seconds
 	GetWorld()->GetTimerManager().SetTimer(TimerHandle, TimerDel, 0.3f, false);
 }
 
+void ABomb::UpdateBombCounters(bool bEndPlay)
+{
+	const bool bCountable = Role == ROLE_Authority && !bIsCosmeticProxy && !bEndPlay;
+	const bool bLive = bCountable && LaunchState.bActive;
+	const bool bArmed = bLive && bIsArmed;
+
+	if (bLive != bCountedLive)
+	{
+		if (bLive)
+		{
+			MYNET_INC_COUNTER(STAT_MyNet_LiveBombs, LiveBombs, 1);
+		}
+		else
+		{
+			MYNET_DEC_COUNTER(STAT_MyNet_LiveBombs, LiveBombs, 1);
+		}
+		bCountedLive = bLive;
+	}
+
+	if (bArmed != bCountedArmed)
+	{
+		if (bArmed)
+		{
+			MYNET_INC_COUNTER(STAT_MyNet_ArmedBombs, ArmedBombs, 1);
+		}
+		else
+		{
+			MYNET_DEC_COUNTER(STAT_MyNet_ArmedBombs, ArmedBombs, 1);
+		}
+		bCountedArmed = bArmed;
+	}
+}
+
+void ABomb::OnPhaseExpired(EBombPhase Phase)
+{
+	switch (Phase)
+	{
+	case EBombPhase::Fuse:
+		Explode();
+		break;
+
+	case EBombPhase::Cleanup:
+		FinishExplosion();
+		break;
+
+	default:
+		break;
+	}
+}
+
+ABombScheduler* ABomb::GetScheduler() const
+{
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	return GameMode ? GameMode->GetBombScheduler() : nullptr;
+}
+
+ABombIntegrator* ABomb::GetIntegrator() const
+{
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	return GameMode ? GameMode->GetBombIntegrator() : nullptr;
+}
+
+void ABomb::FinishExplosion()
+{
+	if (OwningPool)
+	{
+		OwningPool->ReleaseBomb(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
 void ABomb::SimulateExplosionFX_Implementation()
 {
-	if (ExplosionFX)
+	if (ExplosionFX && !bLeanServer)
 	{
+		FStartupCostScope StartupCostScope(GetWorld(), EStartupCost::ExplosionFX);
 		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionFX, GetTransform(), true);
 	}
+}
+
+// ---------------- Pooling
+// -----------------------------
+
+void ABomb::ActivateBomb(const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner)
+{
+	check(Role == ROLE_Authority);
+
+	Instigator = InInstigator;
+	SetOwner(InOwner);
+
+	// Wake up the channel before changing anything, so the clients get the whole new state
+	SetNetDormancy(DORM_Awake);
+
+	bIsArmed = false;
+	ArmBomb();
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	StartProjectile(ComputeLaunchVelocity(GetClass(), Rotation));
+
+	InitLaunchState();
+	UpdateBombCounters();
+
+	ForceNetUpdate();
+}
+
+void ABomb::ResetBomb()
+{
+	check(Role == ROLE_Authority);
+
+	// Drops the pending fuse and explosion timers
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+	if (ABombScheduler* Scheduler = GetScheduler())
+	{
+		Scheduler->Cancel(TimerNode);
+	}
+
+	bIsArmed = false;
+	ArmBomb();
+
+	LaunchState.bActive = false;
+	ReplicationDirty.Mark();
+	StopProjectile();
+	UpdateBombCounters();
+
+	Instigator = nullptr;
+	SetOwner(nullptr);
+
+	// Keep the channel around but stop replicating the idle bomb
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void ABomb::OnRep_LaunchState()
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	if (LaunchState.bActive)
+	{
+		SetActorLocationAndRotation(LaunchState.Location, LaunchState.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		StartProjectile(LaunchState.Velocity);
+
+		if (bReplicateLaunchOnly)
+		{
+			CatchUp(GetServerWorldTime() - LaunchState.LaunchTime);
+		}
+
+		// The throwing player already shows a predicted bomb, which this one replaces
+		AMyNetCharacter* Thrower = Cast<AMyNetCharacter>(Instigator);
+		if (LaunchState.ThrowId != 0 && Thrower && Thrower->IsLocallyControlled())
+		{
+			Thrower->OnThrowConfirmed(LaunchState.ThrowId, this);
+		}
+	}
+	else
+	{
+		StopProjectile();
+	}
+}
+
+void ABomb::StartProjectile(const FVector& Velocity)
+{
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	ProjectileMovementComp->SetUpdatedComponent(SphereComp);
+
+	ProjectileMovementComp->Velocity = Velocity;
+	ProjectileMovementComp->UpdateComponentVelocity();
+
+	// The real bombs of the server can fly batched, the component only keeps the velocity then
+	ABombIntegrator* Integrator = Role == ROLE_Authority && !bIsCosmeticProxy ? GetIntegrator() : nullptr;
+	if (Integrator && Integrator->IsEnabled())
+	{
+		ProjectileMovementComp->SetComponentTickEnabled(false);
+		Integrator->AddBomb(this, Velocity);
+		return;
+	}
+
+	ProjectileMovementComp->SetComponentTickEnabled(true);
+}
+
+void ABomb::StopProjectile()
+{
+	if (BatchIndex != INDEX_NONE)
+	{
+		if (ABombIntegrator* Integrator = GetIntegrator())
+		{
+			Integrator->RemoveBomb(this);
+		}
+	}
+
+	ProjectileMovementComp->StopMovementImmediately();
+	ProjectileMovementComp->SetComponentTickEnabled(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+// ---------------- Launch replication
+// -----------------------------
+
+void ABomb::InitLaunchState()
+{
+	LaunchState.Location = GetActorLocation();
+	LaunchState.Rotation = GetActorRotation();
+	LaunchState.Velocity = ProjectileMovementComp->Velocity;
+	LaunchState.LaunchTime = GetServerWorldTime();
+	LaunchState.ActivationId++;
+	LaunchState.ThrowId = 0;
+	LaunchState.bActive = true;
+	ReplicationDirty.Mark();
+}
+
+void ABomb::SetThrowId(uint8 ThrowId)
+{
+	LaunchState.ThrowId = ThrowId;
+	ReplicationDirty.Mark();
+}
+
+void ABomb::TakeOverProxy(ABomb* Proxy)
+{
+	SetActorLocationAndRotation(Proxy->GetActorLocation(), Proxy->GetActorRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+	StartProjectile(Proxy->ProjectileMovementComp->Velocity);
+}
+
+void ABomb::CatchUp(float Seconds)
+{
+	// Never rewind, and don't try to make up for huge hitches either
+	Seconds = FMath::Min(Seconds, FuseTime);
+	if (Seconds <= 0.f)
+	{
+		return;
+	}
+
+	// Step the same way the component would in its own tick, bounces included
+	const float MaxStep = ProjectileMovementComp->MaxSimulationTimeStep;
+	while (Seconds > KINDA_SMALL_NUMBER && !ProjectileMovementComp->HasStoppedSimulation())
+	{
+		const float Step = FMath::Min(Seconds, MaxStep);
+		ProjectileMovementComp->TickComponent(Step, LEVELTICK_All, nullptr);
+		Seconds -= Step;
+	}
+}
+
+void ABomb::OnRep_Correction()
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	if (!LaunchState.bActive)
+	{
+		return;
+	}
+
+	// Where the server bomb should be by now, if it kept flying freely
+	const float Elapsed = FMath::Max(GetServerWorldTime() - Correction.ServerTime, 0.f);
+	const FVector Gravity(0.f, 0.f, ProjectileMovementComp->GetGravityZ());
+	const FVector ServerLocation = Correction.Location + Correction.Velocity * Elapsed + 0.5f * Gravity * FMath::Square(Elapsed);
+
+	// Small drifts are not worth a visible snap
+	if (FVector::DistSquared(ServerLocation, GetActorLocation()) < FMath::Square(CorrectionThreshold))
+	{
+		return;
+	}
+
+	SetActorLocation(Correction.Location, false, nullptr, ETeleportType::TeleportPhysics);
+	StartProjectile(Correction.Velocity);
+	CatchUp(Elapsed);
+}
+
+float ABomb::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+FVector ABomb::ComputeLaunchVelocity(TSubclassOf<ABomb> BombClass, const FRotator& Rotation)
+{
+	// Mirrors what the projectile movement does when it gets initialized
+	const UProjectileMovementComponent* DefaultMovement = GetDefault<ABomb>(BombClass)->ProjectileMovementComp;
+
+	FVector LaunchVelocity = DefaultMovement->Velocity;
+	if (DefaultMovement->InitialSpeed > 0.f)
+	{
+		LaunchVelocity = LaunchVelocity.GetSafeNormal() * DefaultMovement->InitialSpeed;
+	}
+
+	return DefaultMovement->bInitialVelocityInLocalSpace ? Rotation.RotateVector(LaunchVelocity) : LaunchVelocity;
+}
+
+// ---------------- Cosmetic proxies
+// -----------------------------
+
+void ABomb::LaunchCosmeticProxy(const FVector& Velocity)
+{
+	check(bIsCosmeticProxy);
+
+	ProjectileMovementComp->Velocity = Velocity;
+	ProjectileMovementComp->UpdateComponentVelocity();
+}
+
+void ABomb::ArmCosmeticProxy()
+{
+	check(bIsCosmeticProxy);
+
+	bIsArmed = true;
+	ArmBomb();
 }
\ No newline at end of file
@@ -6,12 +6,73 @@
 #include "GameFramework/Actor.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "BombScheduler.h"
+#include "DirtyReplication.h"
 #include "Bomb.generated.h"
 
+class ABombPool;
+
+/**
+* The state the server sends to clients every time a bomb gets launched.
+* The flight is ballistic, so this is all the clients need to simulate it themselves
+*/
+USTRUCT()
+struct FBombLaunchState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity;
+
+	/** Server world time of the launch, used by clients to catch up */
+	UPROPERTY()
+	float LaunchTime = 0.f;
+
+	/** Bumped on every activation so the clients will get notified even if nothing else changed */
+	UPROPERTY()
+	uint8 ActivationId = 0;
+
+	/** The client prediction this bomb stands for, 0 if the throw wasn't predicted */
+	UPROPERTY()
+	uint8 ThrowId = 0;
+
+	UPROPERTY()
+	bool bActive = false;
+};
+
+/** Server side state of the bomb after a bounce, applied by clients that drifted too far from it */
+USTRUCT()
+struct FBombCorrection
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity;
+
+	/** Server world time the state was taken at */
+	UPROPERTY()
+	float ServerTime = 0.f;
+};
+
 UCLASS()
 class MYNET_API ABomb : public AActor
 {
 	GENERATED_BODY()
+
+	/** Times the private hot paths */
+	friend struct FHotPathBenchmark;
+
+	/** Flies the bomb in place of its projectile movement component */
+	friend class ABombIntegrator;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -21,9 +82,69 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+// ---------------- Pooling
+// -----------------------------
+public:
+	/**
+	* Brings a pooled bomb back to life: places it, wakes its replication channel
+	* and launches the projectile. Server only.
+	*/
+	void ActivateBomb(const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner);
+
+	/** Puts the bomb back in its idle state: disarmed, hidden, not moving and dormant. Server only */
+	void ResetBomb();
+
+	/** Returns true if the bomb is currently in play */
+	bool IsActive() const { return LaunchState.bActive; }
+
+	/** The pool this bomb gets returned to after its explosion. If null the bomb gets destroyed instead */
+	void SetOwningPool(ABombPool* InPool) { OwningPool = InPool; }
+
+	/** Called by the scheduler when the bomb is done waiting in a phase */
+	void OnPhaseExpired(EBombPhase Phase);
+
+	/** Tags the bomb with the predicted throw of the client it stands for. Server only */
+	void SetThrowId(uint8 ThrowId);
+
+	/** Continues the flight from the state of the predicted proxy the player already sees */
+	void TakeOverProxy(ABomb* Proxy);
+
+// ---------------- Cosmetic proxies
+// -----------------------------
+public:
+	/**
+	* Turns a locally spawned bomb into a visual only proxy. A proxy flies and bounces like
+	* a real bomb but never arms, explodes or deals damage by itself. Call before FinishSpawning.
+	*/
+	void SetCosmeticProxy() { bIsCosmeticProxy = true; }
+
+	/** Returns true if this bomb is just a visual */
+	bool IsCosmeticProxy() const { return bIsCosmeticProxy; }
+
+	/** Launches the proxy with the given world velocity */
+	void LaunchCosmeticProxy(const FVector& Velocity);
+
+	/** Shows the proxy as armed */
+	void ArmCosmeticProxy();
+
+	/** Plays the explosion effect locally */
+	void PlayExplosionFX() { SimulateExplosionFX_Implementation(); }
+
+	/** Returns the world space velocity a bomb of the given class gets when launched with the given rotation */
+	static FVector ComputeLaunchVelocity(TSubclassOf<ABomb> BombClass, const FRotator& Rotation);
+
+	// Bomb properties, used by code that simulates bombs without spawning them
+
+	float GetFuseTime() const { return FuseTime; }
+	float GetExplosionRadius() const { return ExplosionRadius; }
+	float GetExplosionDamage() const { return ExplosionDamage; }
+	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovementComp; }
+	USphereComponent* GetSphereComp() const { return SphereComp; }
+
+	/** NetUpdateFrequency as it was at BeginPlay, what AActorSignificanceManager scales down */
+	float GetBaseNetUpdateFrequency() const { return BaseNetUpdateFrequency; }
 
 protected:
 	/** This is static mesh of the comp */
@@ -52,13 +173,102 @@ protected:
 	UPROPERTY(EditAnywhere)
 	UParticleSystem* ExplosionFX;
 
+	/**
+	* If true only the launch parameters and bounce corrections are replicated,
+	* and clients simulate the flight themselves instead of receiving movement updates
+	*/
+	UPROPERTY(EditAnywhere, Category = Replication)
+	bool bReplicateLaunchOnly = true;
+
+	/** How far (in cm) a client simulated bomb may drift from the server before it gets corrected */
+	UPROPERTY(EditAnywhere, Category = Replication)
+	float CorrectionThreshold = 30.f;
+
+	/** Bombs are only relevant to players within ExplosionRadius times this, when there is no cosmetic event manager to match */
+	UPROPERTY(EditAnywhere, Category = Replication)
+	float NetCullRadiusScale = 15.f;
+
 private:
 	/** Marks teh properties we wish to replicate */
 	virtual void GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const;
 
+	/** Skips the comparison of the bomb state when it hasn't changed */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Counts the channels the bomb state went out on, see FDirtyReplicationFlag */
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	/** Lowers the priority for the connections viewing the bomb from afar, see AActorSignificanceManager */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	/** Set at BeginPlay, see GetBaseNetUpdateFrequency */
+	float BaseNetUpdateFrequency = 0.f;
+
+	/** Tells the replication that bIsArmed, LaunchState or Correction changed */
+	FDirtyReplicationFlag ReplicationDirty;
+
 	UPROPERTY(ReplicatedUsing = OnRep_IsArmed)
 	bool bIsArmed = false;
 
+	/** Where, when and how fast the bomb got launched */
+	UPROPERTY(ReplicatedUsing = OnRep_LaunchState)
+	FBombLaunchState LaunchState;
+
+	/** Called when LaunchState gets updated */
+	UFUNCTION()
+	void OnRep_LaunchState();
+
+	/** The server state after the last bounce. Only used when bReplicateLaunchOnly is set */
+	UPROPERTY(ReplicatedUsing = OnRep_Correction)
+	FBombCorrection Correction;
+
+	/** Called when Correction gets updated */
+	UFUNCTION()
+	void OnRep_Correction();
+
+	/** Fills the launch state from the current transform and velocity. Server only */
+	void InitLaunchState();
+
+	/** Runs the local simulation forward to make up for the time the launch state took to arrive */
+	void CatchUp(float Seconds);
+
+	/** Returns the world time of the server, on the server or any client */
+	float GetServerWorldTime() const;
+
+	/** True if the bomb is a local visual only */
+	bool bIsCosmeticProxy = false;
+
+	/** The pool that owns this bomb */
+	UPROPERTY(Transient)
+	ABombPool* OwningPool;
+
+	/** Brings the live and armed bomb counters in line with this bomb. Server only */
+	void UpdateBombCounters(bool bEndPlay = false);
+
+	/** Whether the bomb is currently counted as live and as armed */
+	bool bCountedLive = false;
+	bool bCountedArmed = false;
+
+	/** True if built for a lean server, which skips the materials and particles */
+	bool bLeanServer = false;
+
+	/** The material of the mesh before arming, used to revert the bomb when reset */
+	UPROPERTY(Transient)
+	UMaterialInterface* DefaultMaterial;
+
+	/** The red material, created once and reused across activations */
+	UPROPERTY(Transient)
+	UMaterialInstanceDynamic* ArmedMaterial;
+
+	/** Starts the projectile simulation from the current transform */
+	void StartProjectile(const FVector& Velocity);
+
+	/** Stops the projectile simulation and hides the bomb */
+	void StopProjectile();
+
+	/** Called a bit after the explosion to get rid of the bomb */
+	void FinishExplosion();
+
 	/** Called when bIsArmed gets updated */
 	UFUNCTION()
 	void OnRep_IsArmed();
@@ -70,6 +280,18 @@ private:
 	UFUNCTION()
 	void OnProjectileBounce(const FHitResult& ImpactResult, const FVector& ImpactVelocity);
 
+	/** Node of the bomb in the scheduler, for the fuse and cleanup phases */
+	FBombTimerNode TimerNode;
+
+	/** Returns the bomb scheduler of the server, null on clients */
+	ABombScheduler* GetScheduler() const;
+
+	/** Returns the bomb integrator of the server, null on clients */
+	class ABombIntegrator* GetIntegrator() const;
+
+	/** Index of the bomb in the integrator, INDEX_NONE when it flies on its own */
+	int32 BatchIndex = INDEX_NONE;
+
 	/** Performs an Explosion after a centain amount of time */
 	void PerformDelayedExplosion(float ExplosionDelay);
 
@@ -0,0 +1,398 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BombIntegrator.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "Bomb.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/GameModeBase.h"
+
+/** Keeps the float arrays a multiple of four long, the padding lanes are simulated but never read */
+static void SetPaddedNum(TArray<float>& Array, int32 Num)
+{
+	Array.SetNumZeroed(Align(Num, 4));
+}
+
+ABombIntegrator::ABombIntegrator()
+{
+	// Same tick group as the projectile movement components it replaces
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	// Server only
+	SetReplicates(false);
+
+	bWriteBackEveryFrame = !IsLeanServer();
+}
+
+void ABombIntegrator::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Simulate(DeltaTime);
+}
+
+void ABombIntegrator::AddBomb(ABomb* Bomb, const FVector& Velocity)
+{
+	// Relaunched without having been removed, start over
+	if (Bomb->BatchIndex != INDEX_NONE)
+	{
+		RemoveAt(Bomb->BatchIndex);
+	}
+
+	const UProjectileMovementComponent* Movement = Bomb->ProjectileMovementComp;
+	const FVector Location = Bomb->GetActorLocation();
+
+	const int32 Index = Bombs.Add(Bomb);
+	Bomb->BatchIndex = Index;
+
+	TArray<float>* FloatArrays[] = { &LocationX, &LocationY, &LocationZ, &VelocityX, &VelocityY, &VelocityZ, &EndX, &EndY, &EndZ, &GravityZ, &MaxSpeed };
+	for (TArray<float>* Array : FloatArrays)
+	{
+		SetPaddedNum(*Array, Bombs.Num());
+	}
+
+	LocationX[Index] = Location.X;
+	LocationY[Index] = Location.Y;
+	LocationZ[Index] = Location.Z;
+	VelocityX[Index] = Velocity.X;
+	VelocityY[Index] = Velocity.Y;
+	VelocityZ[Index] = Velocity.Z;
+	GravityZ[Index] = Movement->GetGravityZ();
+	MaxSpeed[Index] = Movement->MaxSpeed > 0.f ? Movement->MaxSpeed : BIG_NUMBER;
+
+	Friction.Add(Movement->Friction);
+	Bounciness.Add(Movement->Bounciness);
+	StopSpeedSquared.Add(FMath::Square(Movement->BounceVelocityStopSimulatingThreshold));
+	bMoving.Add(true);
+	Hits.AddDefaulted();
+	TimeSinceWriteBack.Add(0.f);
+}
+
+void ABombIntegrator::RemoveBomb(ABomb* Bomb)
+{
+	if (Bomb->BatchIndex != INDEX_NONE && Bombs.IsValidIndex(Bomb->BatchIndex) && Bombs[Bomb->BatchIndex] == Bomb)
+	{
+		RemoveAt(Bomb->BatchIndex);
+	}
+}
+
+void ABombIntegrator::RemoveAt(int32 Index)
+{
+	const int32 LastIndex = Bombs.Num() - 1;
+
+	Bombs[Index]->BatchIndex = INDEX_NONE;
+	if (Index != LastIndex)
+	{
+		Bombs[LastIndex]->BatchIndex = Index;
+	}
+
+	Bombs.RemoveAtSwap(Index, 1, false);
+
+	// The vacated last lane becomes padding, zero it so it stays harmless
+	TArray<float>* FloatArrays[] = { &LocationX, &LocationY, &LocationZ, &VelocityX, &VelocityY, &VelocityZ, &EndX, &EndY, &EndZ, &GravityZ, &MaxSpeed };
+	for (TArray<float>* Array : FloatArrays)
+	{
+		(*Array)[Index] = (*Array)[LastIndex];
+		(*Array)[LastIndex] = 0.f;
+		SetPaddedNum(*Array, Bombs.Num());
+	}
+
+	Friction.RemoveAtSwap(Index, 1, false);
+	Bounciness.RemoveAtSwap(Index, 1, false);
+	StopSpeedSquared.RemoveAtSwap(Index, 1, false);
+	bMoving.RemoveAtSwap(Index, 1, false);
+	Hits.RemoveAtSwap(Index, 1, false);
+	TimeSinceWriteBack.RemoveAtSwap(Index, 1, false);
+}
+
+void ABombIntegrator::SyncBomb(ABomb* Bomb)
+{
+	const int32 Index = Bomb->BatchIndex;
+	if (Index == INDEX_NONE || !Bombs.IsValidIndex(Index) || Bombs[Index] != Bomb)
+	{
+		return;
+	}
+
+	Bomb->SetActorLocation(FVector(LocationX[Index], LocationY[Index], LocationZ[Index]), false, nullptr, ETeleportType::TeleportPhysics);
+	Bomb->ProjectileMovementComp->Velocity = FVector(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+	Bomb->ProjectileMovementComp->UpdateComponentVelocity();
+	TimeSinceWriteBack[Index] = 0.f;
+}
+
+void ABombIntegrator::Simulate(float DeltaTime)
+{
+	if (Bombs.Num() == 0 || DeltaTime <= 0.f)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MyNet_BombIntegrator);
+
+	const int32 NumLanes = LocationX.Num();
+	const int32 ChunkSize = Align(FMath::Max(BatchSize, 4), 4);
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumLanes, ChunkSize);
+
+	// Each task integrates and sweeps its own range, the world is only read
+	ParallelFor(NumChunks, [this, ChunkSize, NumLanes, DeltaTime](int32 Chunk)
+	{
+		const int32 Begin = Chunk * ChunkSize;
+		const int32 End = FMath::Min(Begin + ChunkSize, NumLanes);
+
+		Integrate(Begin, End, DeltaTime);
+		Sweep(Begin, FMath::Min(End, Bombs.Num()));
+	}, !bParallel);
+
+	Resolve(DeltaTime);
+}
+
+void ABombIntegrator::Integrate(int32 Begin, int32 End, float DeltaTime)
+{
+	const VectorRegister Step = VectorSetFloat1(DeltaTime);
+	const VectorRegister One = VectorSetFloat1(1.f);
+	const VectorRegister MinSpeedSquared = VectorSetFloat1(SMALL_NUMBER);
+
+	for (int32 Lane = Begin; Lane < End; Lane += 4)
+	{
+		VectorRegister VX = VectorLoad(&VelocityX[Lane]);
+		VectorRegister VY = VectorLoad(&VelocityY[Lane]);
+		VectorRegister VZ = VectorMultiplyAdd(VectorLoad(&GravityZ[Lane]), Step, VectorLoad(&VelocityZ[Lane]));
+
+		// Clamp to the max speed: scale by min(1, MaxSpeed / Speed)
+		const VectorRegister SpeedSquared = VectorMax(VectorMultiplyAdd(VX, VX, VectorMultiplyAdd(VY, VY, VectorMultiply(VZ, VZ))), MinSpeedSquared);
+		const VectorRegister Scale = VectorMin(One, VectorMultiply(VectorLoad(&MaxSpeed[Lane]), VectorReciprocalSqrtAccurate(SpeedSquared)));
+		VX = VectorMultiply(VX, Scale);
+		VY = VectorMultiply(VY, Scale);
+		VZ = VectorMultiply(VZ, Scale);
+
+		VectorStore(VX, &VelocityX[Lane]);
+		VectorStore(VY, &VelocityY[Lane]);
+		VectorStore(VZ, &VelocityZ[Lane]);
+
+		VectorStore(VectorMultiplyAdd(VX, Step, VectorLoad(&LocationX[Lane])), &EndX[Lane]);
+		VectorStore(VectorMultiplyAdd(VY, Step, VectorLoad(&LocationY[Lane])), &EndY[Lane]);
+		VectorStore(VectorMultiplyAdd(VZ, Step, VectorLoad(&LocationZ[Lane])), &EndZ[Lane]);
+	}
+}
+
+void ABombIntegrator::Sweep(int32 Begin, int32 End)
+{
+	static const FName SweepName(TEXT("BombIntegratorSweep"));
+
+	UWorld* World = GetWorld();
+
+	for (int32 Index = Begin; Index < End; Index++)
+	{
+		FHitResult& Hit = Hits[Index];
+		Hit.bBlockingHit = false;
+
+		if (!bMoving[Index])
+		{
+			continue;
+		}
+
+		// The same query the sphere would run when moved by its projectile movement
+		const ABomb* Bomb = Bombs[Index];
+		const USphereComponent* Sphere = Bomb->SphereComp;
+
+		const FVector SweepStart(LocationX[Index], LocationY[Index], LocationZ[Index]);
+		const FVector SweepEnd(EndX[Index], EndY[Index], EndZ[Index]);
+
+		FCollisionQueryParams QueryParams(SweepName, false, Bomb);
+		FCollisionResponseParams ResponseParams(Sphere->GetCollisionResponseToChannels());
+
+		World->SweepSingleByChannel(Hit, SweepStart, SweepEnd, FQuat::Identity, Sphere->GetCollisionObjectType(), FCollisionShape::MakeSphere(Sphere->GetScaledSphereRadius()), QueryParams, ResponseParams);
+	}
+}
+
+void ABombIntegrator::Resolve(float DeltaTime)
+{
+	for (int32 Index = 0; Index < Bombs.Num(); Index++)
+	{
+		if (!bMoving[Index])
+		{
+			continue;
+		}
+
+		ABomb* Bomb = Bombs[Index];
+		const FHitResult& Hit = Hits[Index];
+		TimeSinceWriteBack[Index] += DeltaTime;
+
+		if (!Hit.bBlockingHit)
+		{
+			LocationX[Index] = EndX[Index];
+			LocationY[Index] = EndY[Index];
+			LocationZ[Index] = EndZ[Index];
+
+			if (bWriteBackEveryFrame || TimeSinceWriteBack[Index] >= WriteBackInterval)
+			{
+				SyncBomb(Bomb);
+			}
+			continue;
+		}
+
+		LocationX[Index] = Hit.Location.X;
+		LocationY[Index] = Hit.Location.Y;
+		LocationZ[Index] = Hit.Location.Z;
+
+		// Bounce the same way the projectile movement component does
+		const FVector ImpactVelocity(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+		FVector Velocity = ImpactVelocity;
+
+		const float VDotNormal = Velocity | Hit.Normal;
+		if (VDotNormal <= 0.f)
+		{
+			const FVector ProjectedNormal = Hit.Normal * -VDotNormal;
+
+			Velocity += ProjectedNormal;
+			Velocity *= FMath::Clamp(1.f - Friction[Index], 0.f, 1.f);
+			Velocity += ProjectedNormal * FMath::Max(Bounciness[Index], 0.f);
+		}
+
+		if (Velocity.SizeSquared() < StopSpeedSquared[Index])
+		{
+			Velocity = FVector::ZeroVector;
+			GravityZ[Index] = 0.f;
+			bMoving[Index] = false;
+		}
+
+		VelocityX[Index] = Velocity.X;
+		VelocityY[Index] = Velocity.Y;
+		VelocityZ[Index] = Velocity.Z;
+
+		// The arming logic and the bounce correction read the actor, so it has to be up to date first
+		SyncBomb(Bomb);
+		Bomb->OnProjectileBounce(Hit, ImpactVelocity);
+	}
+}
+
+void ABombIntegrator::RunBenchmark(UWorld* World, TSubclassOf<ABomb> BombClass, int32 NumBombs, int32 NumFrames, double& OutComponentMs, double& OutBatchedMs, double& OutSingleThreadMs)
+{
+	const float DeltaTime = 1.f / 30.f;
+
+	// Visual only bombs falling on the level around the origin, so they sweep, bounce and come to rest
+	TArray<ABomb*> TestBombs;
+	TArray<FVector> StartLocations;
+	TArray<FVector> StartVelocities;
+
+	FRandomStream Random(NumBombs);
+	for (int32 Index = 0; Index < NumBombs; Index++)
+	{
+		const FTransform SpawnTransform(FVector(Random.FRandRange(-5000.f, 5000.f), Random.FRandRange(-5000.f, 5000.f), Random.FRandRange(300.f, 2000.f)));
+
+		ABomb* Bomb = World->SpawnActorDeferred<ABomb>(BombClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (!Bomb)
+		{
+			continue;
+		}
+
+		Bomb->SetReplicates(false);
+		Bomb->SetCosmeticProxy();
+		UGameplayStatics::FinishSpawningActor(Bomb, SpawnTransform);
+		Bomb->ProjectileMovementComp->SetComponentTickEnabled(false);
+
+		TestBombs.Add(Bomb);
+		StartLocations.Add(SpawnTransform.GetLocation());
+		StartVelocities.Add(Random.GetUnitVector() * 800.f);
+	}
+
+	auto ResetBombs = [&]()
+	{
+		for (int32 Index = 0; Index < TestBombs.Num(); Index++)
+		{
+			TestBombs[Index]->SetActorLocation(StartLocations[Index], false, nullptr, ETeleportType::TeleportPhysics);
+			TestBombs[Index]->ProjectileMovementComp->SetUpdatedComponent(TestBombs[Index]->SphereComp);
+			TestBombs[Index]->ProjectileMovementComp->Velocity = StartVelocities[Index];
+		}
+	};
+
+	// The components, ticked directly. The tick manager dispatch they also cost in game isn't included
+	ResetBombs();
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (ABomb* Bomb : TestBombs)
+		{
+			Bomb->ProjectileMovementComp->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+		}
+	}
+	OutComponentMs = 1000.0 * (FPlatformTime::Seconds() - StartTime) / NumFrames;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	ABombIntegrator* Integrator = World->SpawnActor<ABombIntegrator>(SpawnParameters);
+	Integrator->bWriteBackEveryFrame = false;
+	Integrator->SetActorTickEnabled(false);
+
+	for (int32 Pass = 0; Pass < 2; Pass++)
+	{
+		Integrator->bParallel = Pass == 0;
+
+		ResetBombs();
+		for (int32 Index = 0; Index < TestBombs.Num(); Index++)
+		{
+			Integrator->AddBomb(TestBombs[Index], StartVelocities[Index]);
+		}
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			Integrator->Simulate(DeltaTime);
+		}
+		(Pass == 0 ? OutBatchedMs : OutSingleThreadMs) = 1000.0 * (FPlatformTime::Seconds() - StartTime) / NumFrames;
+
+		for (ABomb* Bomb : TestBombs)
+		{
+			Integrator->RemoveBomb(Bomb);
+		}
+	}
+
+	Integrator->Destroy();
+	for (ABomb* Bomb : TestBombs)
+	{
+		Bomb->Destroy();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchBombIntegratorCmd(
+	TEXT("mynet.BenchBombIntegrator"),
+	TEXT("mynet.BenchBombIntegrator [Frames=30] [Counts=1000 10000]. Times the flight of visual only bombs, projectile movement components against the batched integrator"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumFrames = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 30, 1);
+
+		TArray<int32> Counts;
+		for (int32 Index = 1; Index < Args.Num(); Index++)
+		{
+			Counts.Add(FMath::Max(FCString::Atoi(*Args[Index]), 1));
+		}
+		if (Counts.Num() == 0)
+		{
+			Counts.Add(1000);
+			Counts.Add(10000);
+		}
+
+		// The bombs the players throw, if there is a game mode to tell
+		TSubclassOf<ABomb> BombClass = ABomb::StaticClass();
+		const AGameModeBase* GameMode = World->GetAuthGameMode();
+		const AMyNetCharacter* DefaultCharacter = GameMode && GameMode->DefaultPawnClass ? Cast<AMyNetCharacter>(GameMode->DefaultPawnClass->GetDefaultObject()) : nullptr;
+		if (DefaultCharacter && DefaultCharacter->BombActorBP)
+		{
+			BombClass = DefaultCharacter->BombActorBP;
+		}
+
+		UE_LOG(LogMyNet, Log, TEXT("mynet.BenchBombIntegrator: %s, %d frames, %d worker threads"), *BombClass->GetName(), NumFrames, FTaskGraphInterface::Get().GetNumWorkerThreads());
+
+		for (int32 NumBombs : Counts)
+		{
+			double ComponentMs = 0.0;
+			double BatchedMs = 0.0;
+			double SingleThreadMs = 0.0;
+			ABombIntegrator::RunBenchmark(World, BombClass, NumBombs, NumFrames, ComponentMs, BatchedMs, SingleThreadMs);
+
+			UE_LOG(LogMyNet, Log, TEXT("%6d bombs: components %8.3f ms/frame, batched %8.3f ms/frame (%.1fx), batched on one thread %8.3f ms/frame"),
+				NumBombs, ComponentMs, BatchedMs, BatchedMs > 0.0 ? ComponentMs / BatchedMs : 0.0, SingleThreadMs);
+		}
+	}));
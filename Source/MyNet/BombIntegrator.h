@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "BombIntegrator.generated.h"
+
+class ABomb;
+
+/**
+* Batched flight simulation of the server bombs, replacing one projectile movement tick per bomb.
+* The bombs in flight are kept as a structure of arrays. Every frame they are integrated four at a time
+* with vector math, their sweeps run on the worker threads, and the bounces go through
+* ABomb::OnProjectileBounce on the game thread like before.
+* The actor transforms are only written back on bounces, before explosions and every WriteBackInterval,
+* or every frame where the bombs are rendered. See bBatchSimulation and mynet.BenchBombIntegrator.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API ABombIntegrator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ABombIntegrator();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns true if the bombs should be handed to the integrator instead of flying on their own */
+	bool IsEnabled() const { return bBatchSimulation; }
+
+	/** Starts simulating a bomb from its current location */
+	void AddBomb(ABomb* Bomb, const FVector& Velocity);
+
+	/** Stops simulating a bomb */
+	void RemoveBomb(ABomb* Bomb);
+
+	/** Writes the simulated location and velocity of a bomb to the actor and its movement component */
+	void SyncBomb(ABomb* Bomb);
+
+	/** Moves every bomb one step */
+	void Simulate(float DeltaTime);
+
+	/** Returns the number of bombs in flight or at rest */
+	int32 Num() const { return Bombs.Num(); }
+
+	/**
+	* Flies NumBombs visual only bombs for NumFrames frames with their components, then batched on the worker threads and on the game thread.
+	* Returns the average milliseconds per frame of each. Used by mynet.BenchBombIntegrator
+	*/
+	static void RunBenchmark(UWorld* World, TSubclassOf<ABomb> BombClass, int32 NumBombs, int32 NumFrames, double& OutComponentMs, double& OutBatchedMs, double& OutSingleThreadMs);
+
+protected:
+	/** If false the bombs fly with their own projectile movement component */
+	UPROPERTY(Config, EditAnywhere, Category = Simulation)
+	bool bBatchSimulation = false;
+
+	/** Bombs per worker thread task */
+	UPROPERTY(Config, EditAnywhere, Category = Simulation)
+	int32 BatchSize = 256;
+
+	/** If false everything runs on the game thread, for comparisons */
+	UPROPERTY(Config, EditAnywhere, Category = Simulation)
+	bool bParallel = true;
+
+	/** Seconds between two transform write-backs of a bomb that didn't bounce. Relevancy and significance read the actor location */
+	UPROPERTY(Config, EditAnywhere, Category = Simulation)
+	float WriteBackInterval = 0.1f;
+
+private:
+	/** Removes the bomb at an index, moving the last one in its place */
+	void RemoveAt(int32 Index);
+
+	/** Integrates the lanes [Begin, End), four at a time */
+	void Integrate(int32 Begin, int32 End, float DeltaTime);
+
+	/** Sweeps the moving bombs of [Begin, End) */
+	void Sweep(int32 Begin, int32 End);
+
+	/** Bounces and writes back the bombs, on the game thread */
+	void Resolve(float DeltaTime);
+
+	// One entry per bomb. The float arrays are padded to a multiple of four for the vector math
+
+	TArray<ABomb*> Bombs;
+
+	TArray<float> LocationX;
+	TArray<float> LocationY;
+	TArray<float> LocationZ;
+
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+
+	/** Where the bombs end up if nothing is in the way, written by Integrate */
+	TArray<float> EndX;
+	TArray<float> EndY;
+	TArray<float> EndZ;
+
+	/** World gravity times the gravity scale of the bomb, 0 once it stopped */
+	TArray<float> GravityZ;
+
+	/** Max speed, a huge value for no limit */
+	TArray<float> MaxSpeed;
+
+	// Bounce properties, only read on bounces
+
+	TArray<float> Friction;
+	TArray<float> Bounciness;
+	TArray<float> StopSpeedSquared;
+
+	/** False once the bomb came to rest */
+	TArray<bool> bMoving;
+
+	/** Results of the sweeps, bBlockingHit is false when nothing got hit */
+	TArray<FHitResult> Hits;
+
+	/** Time since the transform was written back */
+	TArray<float> TimeSinceWriteBack;
+
+	/** True if the bombs get rendered here, which needs their transforms every frame */
+	bool bWriteBackEveryFrame = false;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BombPool.h"
+#include "MyNet.h"
+#include "EngineUtils.h"
+
+ABombPool::ABombPool()
+{
+	// The pool is never replicated, it only lives on the server
+	SetReplicates(false);
+}
+
+void ABombPool::Prewarm(TSubclassOf<ABomb> BombClass)
+{
+	if (!BombClass)
+	{
+		return;
+	}
+
+	FBombPoolBucket& Bucket = Buckets.FindOrAdd(BombClass);
+	Grow(BombClass, Bucket, InitialPoolSize - Bucket.NumOwned);
+}
+
+ABomb* ABombPool::AcquireBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner)
+{
+	if (!BombClass)
+	{
+		return nullptr;
+	}
+
+	FBombPoolBucket& Bucket = Buckets.FindOrAdd(BombClass);
+
+	if (Bucket.FreeBombs.Num() > 0)
+	{
+		NumHits++;
+	}
+	else
+	{
+		NumMisses++;
+
+		const int32 NumAdded = bAllowGrowth ? Grow(BombClass, Bucket, GrowthStep) : 0;
+		NumGrown += NumAdded;
+
+		if (NumAdded == 0)
+		{
+			NumTransient++;
+			return SpawnTransientBomb(BombClass, Location, Rotation, InInstigator, InOwner);
+		}
+	}
+
+	ABomb* Bomb = Bucket.FreeBombs.Pop(false);
+	Bomb->ActivateBomb(Location, Rotation, InInstigator, InOwner);
+
+	return Bomb;
+}
+
+void ABombPool::ReleaseBomb(ABomb* Bomb)
+{
+	check(Bomb);
+
+	Bomb->ResetBomb();
+	Buckets.FindOrAdd(Bomb->GetClass()).FreeBombs.Push(Bomb);
+}
+
+void ABombPool::LogStats() const
+{
+	for (const TPair<UClass*, FBombPoolBucket>& Pair : Buckets)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("BombPool %s: %d owned, %d free"), *GetNameSafe(Pair.Key), Pair.Value.NumOwned, Pair.Value.FreeBombs.Num());
+	}
+
+	const int32 NumAcquires = NumHits + NumMisses;
+	UE_LOG(LogMyNet, Log, TEXT("BombPool: %d hits, %d misses (%.1f%% hit rate), %d grown, %d transient"),
+		NumHits, NumMisses, NumAcquires > 0 ? 100.f * NumHits / NumAcquires : 0.f, NumGrown, NumTransient);
+}
+
+ABomb* ABombPool::SpawnPooledBomb(TSubclassOf<ABomb> BombClass, FBombPoolBucket& Bucket)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABomb* Bomb = GetWorld()->SpawnActor<ABomb>(BombClass, GetActorLocation(), FRotator::ZeroRotator, SpawnParameters);
+	if (Bomb)
+	{
+		Bomb->SetOwningPool(this);
+		Bomb->ResetBomb();
+		Bucket.NumOwned++;
+	}
+
+	return Bomb;
+}
+
+ABomb* ABombPool::SpawnTransientBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Instigator = InInstigator;
+	SpawnParameters.Owner = InOwner;
+
+	// No owning pool, so this one gets destroyed after the explosion like before
+	return GetWorld()->SpawnActor<ABomb>(BombClass, Location, Rotation, SpawnParameters);
+}
+
+int32 ABombPool::Grow(TSubclassOf<ABomb> BombClass, FBombPoolBucket& Bucket, int32 Count)
+{
+	const int32 NumToAdd = FMath::Min(Count, MaxPoolSize - Bucket.NumOwned);
+
+	int32 NumAdded = 0;
+	for (int32 Index = 0; Index < NumToAdd; Index++)
+	{
+		if (ABomb* Bomb = SpawnPooledBomb(BombClass, Bucket))
+		{
+			Bucket.FreeBombs.Push(Bomb);
+			NumAdded++;
+		}
+	}
+
+	return NumAdded;
+}
+
+static FAutoConsoleCommandWithWorld BombPoolStatsCmd(
+	TEXT("mynet.BombPoolStats"),
+	TEXT("Logs the bomb pool hit/miss counters"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<ABombPool> It(World); It; ++It)
+		{
+			It->LogStats();
+		}
+	}));
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Bomb.h"
+#include "BombPool.generated.h"
+
+/** The bombs kept for a single bomb class */
+USTRUCT()
+struct FBombPoolBucket
+{
+	GENERATED_BODY()
+
+	/** Bombs ready to be activated */
+	UPROPERTY()
+	TArray<ABomb*> FreeBombs;
+
+	/** Number of bombs this bucket owns, in play or not */
+	int32 NumOwned = 0;
+};
+
+/**
+* Server side pool of bombs. Instead of spawning and destroying an actor for every throw,
+* bombs are created up front, activated when thrown and reset when they are done exploding.
+* Their replication channels are kept through dormancy instead of being closed.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API ABombPool : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ABombPool();
+
+	/** Makes sure the pool of the given class holds at least InitialPoolSize bombs */
+	void Prewarm(TSubclassOf<ABomb> BombClass);
+
+	/** Takes a bomb out of the pool (growing it if needed) and launches it from the given transform */
+	ABomb* AcquireBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner);
+
+	/** Gives a bomb back to the pool */
+	void ReleaseBomb(ABomb* Bomb);
+
+	/** Writes the hit/miss counters to the log */
+	void LogStats() const;
+
+protected:
+	/** How many bombs per class get created when the pool is prewarmed */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	int32 InitialPoolSize = 16;
+
+	/** If false, an empty pool spawns a one-off bomb that gets destroyed after its explosion */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	bool bAllowGrowth = true;
+
+	/** How many bombs are added at once when an empty pool grows */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	int32 GrowthStep = 4;
+
+	/** The pool of a single class never grows past this */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	int32 MaxPoolSize = 256;
+
+private:
+	/** Spawns a bomb for the pool and puts it straight to sleep */
+	ABomb* SpawnPooledBomb(TSubclassOf<ABomb> BombClass, FBombPoolBucket& Bucket);
+
+	/** Spawns a bomb that doesn't belong to the pool */
+	ABomb* SpawnTransientBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InOwner);
+
+	/** Adds up to Count bombs to the bucket, returns how many got added */
+	int32 Grow(TSubclassOf<ABomb> BombClass, FBombPoolBucket& Bucket, int32 Count);
+
+	UPROPERTY()
+	TMap<UClass*, FBombPoolBucket> Buckets;
+
+	// Counters used to size the pool
+
+	/** Acquires served from a free bomb */
+	int32 NumHits = 0;
+
+	/** Acquires that found the pool empty */
+	int32 NumMisses = 0;
+
+	/** Bombs added after prewarming */
+	int32 NumGrown = 0;
+
+	/** Bombs spawned outside of the pool because it couldn't grow */
+	int32 NumTransient = 0;
+};
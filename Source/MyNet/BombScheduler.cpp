@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BombScheduler.h"
+#include "MyNet.h"
+#include "Bomb.h"
+
+// ---------------- Timer wheel
+// -----------------------------
+
+FBombTimerWheel::FBombTimerWheel(int32 InNumSlots, double InSlotDuration)
+{
+	Slots.SetNumZeroed(FMath::Max(InNumSlots, 1));
+	SlotDuration = FMath::Max(InSlotDuration, KINDA_SMALL_NUMBER);
+}
+
+void FBombTimerWheel::Schedule(FBombTimerNode& Node, EBombPhase Phase, double FireTime)
+{
+	Cancel(Node);
+
+	// Never schedule in a slot that has already been swept
+	const int64 FireTick = FMath::Max(FireTimeToTick(FireTime), CurrentTick + 1);
+	const int32 Slot = (int32)(FireTick % Slots.Num());
+
+	Node.Phase = Phase;
+	Node.FireTime = FireTime;
+	Node.Slot = Slot;
+	Node.Prev = nullptr;
+	Node.Next = Slots[Slot];
+
+	if (Node.Next)
+	{
+		Node.Next->Prev = &Node;
+	}
+	Slots[Slot] = &Node;
+
+	NumScheduled++;
+}
+
+void FBombTimerWheel::Cancel(FBombTimerNode& Node)
+{
+	if (!Node.IsScheduled())
+	{
+		return;
+	}
+
+	if (Node.Prev)
+	{
+		Node.Prev->Next = Node.Next;
+	}
+	else
+	{
+		Slots[Node.Slot] = Node.Next;
+	}
+
+	if (Node.Next)
+	{
+		Node.Next->Prev = Node.Prev;
+	}
+
+	Node.Prev = nullptr;
+	Node.Next = nullptr;
+	Node.Slot = INDEX_NONE;
+
+	NumScheduled--;
+}
+
+FBombTimerNode* FBombTimerWheel::CollectExpired(double Now)
+{
+	const int64 TargetTick = TimeToTick(Now);
+	if (TargetTick <= CurrentTick)
+	{
+		return nullptr;
+	}
+
+	// After a long hitch a single turn is enough to see every slot
+	const int64 NumTicks = FMath::Min<int64>(TargetTick - CurrentTick, Slots.Num());
+
+	FBombTimerNode* ExpiredHead = nullptr;
+	FBombTimerNode* ExpiredTail = nullptr;
+
+	for (int64 Tick = CurrentTick + 1; Tick <= CurrentTick + NumTicks; Tick++)
+	{
+		FBombTimerNode* Node = Slots[(int32)(Tick % Slots.Num())];
+		while (Node)
+		{
+			FBombTimerNode* Next = Node->Next;
+
+			// Nodes due in a later turn stay where they are
+			if (Node->FireTime <= Now)
+			{
+				Cancel(*Node);
+
+				if (ExpiredTail)
+				{
+					ExpiredTail->Next = Node;
+				}
+				else
+				{
+					ExpiredHead = Node;
+				}
+				ExpiredTail = Node;
+			}
+
+			Node = Next;
+		}
+	}
+
+	CurrentTick = TargetTick;
+
+	return ExpiredHead;
+}
+
+// ---------------- Scheduler actor
+// -----------------------------
+
+ABombScheduler::ABombScheduler()
+{
+	// Fire before the explosion manager resolves the explosions of the frame
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	// Server only
+	SetReplicates(false);
+}
+
+void ABombScheduler::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// The config values are in by now
+	Wheel = FBombTimerWheel(NumSlots, SlotDuration);
+}
+
+void ABombScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Wheel.Advance(GetWorld()->GetTimeSeconds(), [](FBombTimerNode& Node)
+	{
+		if (Node.Bomb)
+		{
+			Node.Bomb->OnPhaseExpired(Node.Phase);
+		}
+	});
+}
+
+void ABombScheduler::Schedule(FBombTimerNode& Node, EBombPhase Phase, float Delay)
+{
+	Wheel.Schedule(Node, Phase, GetWorld()->GetTimeSeconds() + Delay);
+}
+
+void ABombScheduler::Cancel(FBombTimerNode& Node)
+{
+	Wheel.Cancel(Node);
+}
+
+static FAutoConsoleCommandWithArgs BenchFusesCmd(
+	TEXT("mynet.BenchFuses"),
+	TEXT("mynet.BenchFuses [NumFuses=10000]. Times scheduling and firing that many concurrent fuses with the timer wheel and with a timer manager"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumFuses = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000, 1);
+		const float TickDelta = 1.f / 60.f;
+		const float MaxFuse = 5.f;
+
+		// Same fuses for both
+		TArray<float> Fuses;
+		FRandomStream Random(NumFuses);
+		for (int32 Index = 0; Index < NumFuses; Index++)
+		{
+			Fuses.Add(Random.FRandRange(0.5f, MaxFuse));
+		}
+
+		int32 NumFired = 0;
+
+		// Timer wheel
+		TArray<FBombTimerNode> Nodes;
+		Nodes.SetNum(NumFuses);
+		FBombTimerWheel Wheel;
+
+		// Every fuse has to fire by the first sweep a slot past its fire time
+		const double MaxLateness = Wheel.GetSlotDuration() + TickDelta;
+		double WorstLateness = 0.0;
+		int32 NumLate = 0;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumFuses; Index++)
+		{
+			Wheel.Schedule(Nodes[Index], EBombPhase::Fuse, Fuses[Index]);
+		}
+		const double WheelScheduleSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (double Now = 0.0; Wheel.Num() > 0; Now += TickDelta)
+		{
+			Wheel.Advance(Now, [&NumFired, &WorstLateness, &NumLate, Now, MaxLateness](FBombTimerNode& Node)
+			{
+				const double Lateness = Now - Node.FireTime;
+				WorstLateness = FMath::Max(WorstLateness, Lateness);
+				NumLate += Lateness > MaxLateness;
+				NumFired++;
+			});
+		}
+		const double WheelTickSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// Timer manager, one delegate per fuse like ABomb used to do
+		FTimerManager TimerManager;
+		TArray<FTimerHandle> Handles;
+		Handles.SetNum(NumFuses);
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumFuses; Index++)
+		{
+			TimerManager.SetTimer(Handles[Index], FTimerDelegate::CreateLambda([&NumFired]() { NumFired++; }), Fuses[Index], false);
+		}
+		const double TimerScheduleSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// The timer manager only ticks once per engine frame, so it gets a single tick covering all the fuses.
+		// That spares it the per frame cost the wheel pays above
+		StartTime = FPlatformTime::Seconds();
+		TimerManager.Tick(MaxFuse + TickDelta);
+		const double TimerTickSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogMyNet, Log, TEXT("mynet.BenchFuses: %d fuses, %d fired"), NumFuses, NumFired);
+		UE_LOG(LogMyNet, Log, TEXT("  timer wheel:   schedule %8.3f ms, tick %8.3f ms"), 1000.0 * WheelScheduleSeconds, 1000.0 * WheelTickSeconds);
+		UE_LOG(LogMyNet, Log, TEXT("  timer manager: schedule %8.3f ms, tick %8.3f ms"), 1000.0 * TimerScheduleSeconds, 1000.0 * TimerTickSeconds);
+
+		if (NumLate > 0)
+		{
+			UE_LOG(LogMyNet, Error, TEXT("mynet.BenchFuses: %d fuses fired more than a slot late, up to %.3f ms"), NumLate, 1000.0 * WorstLateness);
+		}
+		else
+		{
+			UE_LOG(LogMyNet, Log, TEXT("  every fuse fired within a slot, at most %.3f ms late"), 1000.0 * WorstLateness);
+		}
+	}));
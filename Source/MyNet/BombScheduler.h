@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "BombScheduler.generated.h"
+
+class ABomb;
+
+/** The lifecycle phases a bomb waits in */
+enum class EBombPhase : uint8
+{
+	None,
+
+	/** Armed, waiting to explode */
+	Fuse,
+
+	/** Exploded, waiting to be destroyed or returned to the pool */
+	Cleanup
+};
+
+/**
+* Entry of the timer wheel. Embedded in the bombs themselves,
+* so scheduling a bomb never allocates anything.
+*/
+struct FBombTimerNode
+{
+	/** The bomb owning the node. Can be null for benchmarks */
+	ABomb* Bomb = nullptr;
+
+	/** The phase that ends when the node fires */
+	EBombPhase Phase = EBombPhase::None;
+
+	double FireTime = 0.0;
+
+	/** The wheel slot the node is linked in, INDEX_NONE when not scheduled */
+	int32 Slot = INDEX_NONE;
+
+	FBombTimerNode* Prev = nullptr;
+	FBombTimerNode* Next = nullptr;
+
+	bool IsScheduled() const { return Slot != INDEX_NONE; }
+};
+
+/**
+* Hashed timer wheel. Time is cut in ticks of SlotDuration and every tick maps to a slot,
+* wrapping around. A node sits in the slot of the first tick starting at or after its fire time,
+* so the sweep of that slot always finds it due and it fires at most a slot late. Nodes of a
+* later turn get skipped by the sweeps, so fuses longer than a full turn work too.
+*/
+class MYNET_API FBombTimerWheel
+{
+public:
+	explicit FBombTimerWheel(int32 InNumSlots = 256, double InSlotDuration = 1.0 / 60.0);
+
+	/** Schedules (or reschedules) a node to fire at the given time */
+	void Schedule(FBombTimerNode& Node, EBombPhase Phase, double FireTime);
+
+	/** Removes a node from the wheel, if it is in it */
+	void Cancel(FBombTimerNode& Node);
+
+	/**
+	* Moves the wheel forward to the given time and calls OnExpired(FBombTimerNode&) for every node that is due.
+	* Nodes are unlinked before the call, so the callback may schedule them again.
+	*/
+	template<typename FuncType>
+	void Advance(double Now, FuncType&& OnExpired)
+	{
+		FBombTimerNode* Expired = CollectExpired(Now);
+		while (Expired)
+		{
+			FBombTimerNode* Next = Expired->Next;
+			Expired->Next = nullptr;
+			OnExpired(*Expired);
+			Expired = Next;
+		}
+	}
+
+	/** Returns the number of scheduled nodes */
+	int32 Num() const { return NumScheduled; }
+
+	/** Returns the time covered by a slot, the most a node fires late */
+	double GetSlotDuration() const { return SlotDuration; }
+
+private:
+	/** Returns the tick a time is in */
+	int64 TimeToTick(double Time) const { return (int64)FMath::FloorToDouble(Time / SlotDuration); }
+
+	/** Returns the first tick starting at or after a fire time. Nudged up, so rounding can't file a node in a tick that starts before it's due */
+	int64 FireTimeToTick(double FireTime) const { return (int64)FMath::CeilToDouble(FireTime / SlotDuration + 1e-6); }
+
+	/** Unlinks the due nodes and returns them as a list chained through Next */
+	FBombTimerNode* CollectExpired(double Now);
+
+	/** Head of the node list of every slot */
+	TArray<FBombTimerNode*> Slots;
+
+	double SlotDuration;
+
+	/** The last tick that got swept */
+	int64 CurrentTick = 0;
+
+	int32 NumScheduled = 0;
+};
+
+/**
+* Drives the fuse and cleanup phases of all the bombs from a single tick,
+* instead of a timer manager entry with its own delegate per bomb. Server only.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API ABombScheduler : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ABombScheduler();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Makes the bomb leave the given phase after Delay seconds */
+	void Schedule(FBombTimerNode& Node, EBombPhase Phase, float Delay);
+
+	/** Cancels whatever the node was waiting for */
+	void Cancel(FBombTimerNode& Node);
+
+protected:
+	/** Number of slots of the wheel */
+	UPROPERTY(Config, EditAnywhere, Category = Scheduler)
+	int32 NumSlots = 256;
+
+	/** Time covered by a slot. Phases end at most this late */
+	UPROPERTY(Config, EditAnywhere, Category = Scheduler)
+	float SlotDuration = 1.f / 60.f;
+
+	virtual void PostInitProperties() override;
+
+private:
+	FBombTimerWheel Wheel;
+};
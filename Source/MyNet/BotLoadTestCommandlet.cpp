@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BotLoadTestCommandlet.h"
+#include "MyNet.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+#include "HAL/PlatformProcess.h"
+
+/** Seconds the server gets to load the map before the clients connect */
+static const float ServerStartDelay = 15.f;
+
+/** Seconds on top of the run after which the server is considered stuck */
+static const float ServerTimeoutMargin = 120.f;
+
+UBotLoadTestCommandlet::UBotLoadTestCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBotLoadTestCommandlet::Main(const FString& Params)
+{
+	const TCHAR* ParamsStr = *Params;
+
+	int32 NumBots = 16;
+	float Duration = 60.f;
+	FString Map = TEXT("/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap");
+	FString Pattern = TEXT("Random");
+	FString CsvPath = FPaths::ConvertRelativePathToFull(FPaths::GameSavedDir() / TEXT("LoadTest") / TEXT("LoadTest.csv"));
+	FString Label = FApp::GetBuildVersion();
+	int32 NumMatches = 1;
+	float StepRate = 0.f;
+	float NetTickRate = 0.f;
+
+	FParse::Value(ParamsStr, TEXT("Bots="), NumBots);
+	FParse::Value(ParamsStr, TEXT("Duration="), Duration);
+	FParse::Value(ParamsStr, TEXT("Map="), Map);
+	FParse::Value(ParamsStr, TEXT("Pattern="), Pattern);
+	FParse::Value(ParamsStr, TEXT("Csv="), CsvPath);
+	FParse::Value(ParamsStr, TEXT("Label="), Label);
+	FParse::Value(ParamsStr, TEXT("Matches="), NumMatches);
+	FParse::Value(ParamsStr, TEXT("FixedStep="), StepRate);
+	FParse::Value(ParamsStr, TEXT("NetTickRate="), NetTickRate);
+
+	const FString Executable = FPlatformProcess::ExecutableName(false);
+	const FString ExecutablePath = FString(FPlatformProcess::BaseDir()) / Executable;
+	const FString Project = FString::Printf(TEXT("\"%s\""), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()));
+
+	// The default session only lets 16 players in
+	FString ServerArgs = FString::Printf(TEXT("%s %s?MaxPlayers=%d -server -nullrhi -unattended -nosound -log -LoadTest -LoadTestPlayers=%d -LoadTestDuration=%.0f -LoadTestCsv=\"%s\" -LoadTestLabel=\"%s\""),
+		*Project, *Map, NumBots, NumBots, Duration, *CsvPath, *Label);
+
+	// The bots fill the matches evenly
+	if (NumMatches > 1)
+	{
+		ServerArgs += FString::Printf(TEXT(" -Matches=%d -MatchPlayers=%d"), NumMatches, FMath::DivideAndRoundUp(NumBots, NumMatches));
+	}
+
+	if (StepRate > 0.f)
+	{
+		ServerArgs += FString::Printf(TEXT(" -FixedStep=%g -NetTickRate=%g"), StepRate, NetTickRate);
+	}
+
+	UE_LOG(LogMyNet, Display, TEXT("BotLoadTest: %d bots, %.0f seconds, results in %s"), NumBots, Duration, *CsvPath);
+
+	FProcHandle ServerHandle = FPlatformProcess::CreateProc(*ExecutablePath, *ServerArgs, true, false, false, nullptr, 0, nullptr, nullptr);
+	if (!ServerHandle.IsValid())
+	{
+		UE_LOG(LogMyNet, Error, TEXT("BotLoadTest: could not start the server %s %s"), *ExecutablePath, *ServerArgs);
+		return 1;
+	}
+
+	FPlatformProcess::Sleep(ServerStartDelay);
+
+	TArray<FProcHandle> ClientHandles;
+	for (int32 Index = 0; Index < NumBots; Index++)
+	{
+		const FString ClientArgs = FString::Printf(TEXT("%s 127.0.0.1 -game -nullrhi -unattended -nosound -BotClient -BotSeed=%d -BotPattern=%s"),
+			*Project, Index + 1, *Pattern);
+
+		FProcHandle ClientHandle = FPlatformProcess::CreateProc(*ExecutablePath, *ClientArgs, true, true, true, nullptr, 0, nullptr, nullptr);
+		if (ClientHandle.IsValid())
+		{
+			ClientHandles.Add(ClientHandle);
+		}
+		else
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("BotLoadTest: could not start bot %d"), Index);
+		}
+
+		// Don't have every client log in the same frame
+		FPlatformProcess::Sleep(0.1f);
+	}
+
+	// The server quits by itself once the summary is written
+	const double TimeoutTime = FPlatformTime::Seconds() + Duration + ServerTimeoutMargin;
+	while (FPlatformProcess::IsProcRunning(ServerHandle) && FPlatformTime::Seconds() < TimeoutTime)
+	{
+		FPlatformProcess::Sleep(1.f);
+	}
+
+	int32 ServerReturnCode = 0;
+	const bool bServerFinished = !FPlatformProcess::IsProcRunning(ServerHandle);
+	if (bServerFinished)
+	{
+		FPlatformProcess::GetProcReturnCode(ServerHandle, &ServerReturnCode);
+	}
+	else
+	{
+		UE_LOG(LogMyNet, Error, TEXT("BotLoadTest: the server did not finish in time"));
+		FPlatformProcess::TerminateProc(ServerHandle, true);
+	}
+	FPlatformProcess::CloseProc(ServerHandle);
+
+	for (FProcHandle& ClientHandle : ClientHandles)
+	{
+		if (FPlatformProcess::IsProcRunning(ClientHandle))
+		{
+			FPlatformProcess::TerminateProc(ClientHandle, true);
+		}
+		FPlatformProcess::CloseProc(ClientHandle);
+	}
+
+	if (!bServerFinished || ServerReturnCode != 0)
+	{
+		return 1;
+	}
+
+	UE_LOG(LogMyNet, Display, TEXT("BotLoadTest: done, see %s"), *CsvPath);
+	return 0;
+}
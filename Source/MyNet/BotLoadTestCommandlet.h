@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BotLoadTestCommandlet.generated.h"
+
+/**
+* Runs a bot load test over loopback: a NullRHI dedicated server plus headless bot clients,
+* all child processes of this one. The server records the run with ALoadTestRecorder and appends
+* a summary to a CSV, so runs of different builds and player counts can be compared.
+*
+* UE4Editor-Cmd MyNet.uproject -run=BotLoadTest -Bots=64 [-Duration=60] [-Map=/Game/...] [-Pattern=Random|Circle] [-Csv=Path] [-Label=Name] [-Matches=N] [-FixedStep=Hz [-NetTickRate=Hz]]
+*
+* With -Matches the bots get split over N matches hosted by the one server, see AMatchManager.
+* Compare with runs of one match of Bots/N bots for the process per match numbers.
+*
+* With -FixedStep the server runs in fixed steps of that rate and replicates at NetTickRate, see AServerTickManager.
+*/
+UCLASS()
+class UBotLoadTestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBotLoadTestCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
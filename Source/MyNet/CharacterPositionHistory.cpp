@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CharacterPositionHistory.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+
+void FCharacterPositionHistory::Init(int32 InMaxCharacters, int32 InNumFrames)
+{
+	MaxCharacters = FMath::Max(InMaxCharacters, 1);
+	NumFrames = FMath::Max(InNumFrames, 2);
+	NextFrame = 0;
+	NumRecorded = 0;
+
+	X.SetNumZeroed(MaxCharacters * NumFrames);
+	Y.SetNumZeroed(MaxCharacters * NumFrames);
+	Z.SetNumZeroed(MaxCharacters * NumFrames);
+
+	FrameTimes.SetNumZeroed(NumFrames);
+	FrameSerials.SetNumZeroed(NumFrames);
+
+	SlotCharacters.SetNumZeroed(MaxCharacters);
+	SlotFirstSerials.SetNumZeroed(MaxCharacters);
+
+	// Handed out from the back, so the low slots get used first
+	FreeSlots.Reset(MaxCharacters);
+	for (int32 Slot = MaxCharacters - 1; Slot >= 0; Slot--)
+	{
+		FreeSlots.Add(Slot);
+	}
+
+	SlotIndices.Empty(MaxCharacters);
+}
+
+bool FCharacterPositionHistory::Add(AMyNetCharacter* Character)
+{
+	if (SlotIndices.Contains(Character))
+	{
+		return true;
+	}
+
+	if (FreeSlots.Num() == 0)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Position history full (%d characters), %s won't be lag compensated"), MaxCharacters, *GetNameSafe(Character));
+		return false;
+	}
+
+	const int32 Slot = FreeSlots.Pop(false);
+	SlotCharacters[Slot] = Character;
+
+	// The frames recorded before now belong to the previous owner of the slot
+	SlotFirstSerials[Slot] = NumRecorded;
+	SlotIndices.Add(Character, Slot);
+
+	return true;
+}
+
+void FCharacterPositionHistory::Remove(AMyNetCharacter* Character)
+{
+	int32 Slot = INDEX_NONE;
+	if (SlotIndices.RemoveAndCopyValue(Character, Slot))
+	{
+		SlotCharacters[Slot] = nullptr;
+		FreeSlots.Add(Slot);
+	}
+}
+
+void FCharacterPositionHistory::Record(float Time)
+{
+	if (NumFrames == 0)
+	{
+		return;
+	}
+
+	const int32 RowStart = NextFrame * MaxCharacters;
+
+	for (int32 Slot = 0; Slot < MaxCharacters; Slot++)
+	{
+		if (const AMyNetCharacter* Character = SlotCharacters[Slot])
+		{
+			const FVector Location = Character->GetActorLocation();
+			X[RowStart + Slot] = Location.X;
+			Y[RowStart + Slot] = Location.Y;
+			Z[RowStart + Slot] = Location.Z;
+		}
+	}
+
+	FrameTimes[NextFrame] = Time;
+	FrameSerials[NextFrame] = NumRecorded;
+
+	NextFrame = (NextFrame + 1) % NumFrames;
+	NumRecorded++;
+}
+
+FPositionHistoryFrames FCharacterPositionHistory::FindFrames(float Time) const
+{
+	FPositionHistoryFrames Frames;
+
+	const int32 NumValid = (int32)FMath::Min<uint32>(NumRecorded, NumFrames);
+	if (NumValid == 0 || Time >= FrameTimes[GetFrameIndex(0)])
+	{
+		return Frames;
+	}
+
+	// Older than the whole ring, use the oldest frame
+	const int32 OldestAge = NumValid - 1;
+	if (Time <= FrameTimes[GetFrameIndex(OldestAge)])
+	{
+		Frames.Older = Frames.Newer = GetFrameIndex(OldestAge);
+		return Frames;
+	}
+
+	// Binary search of the newest frame at or before Time. Ages go back in time, so the times decrease with the age
+	int32 Low = 1;
+	int32 High = OldestAge;
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High) / 2;
+		if (FrameTimes[GetFrameIndex(Middle)] <= Time)
+		{
+			High = Middle;
+		}
+		else
+		{
+			Low = Middle + 1;
+		}
+	}
+
+	Frames.Older = GetFrameIndex(Low);
+	Frames.Newer = GetFrameIndex(Low - 1);
+
+	const float OlderTime = FrameTimes[Frames.Older];
+	const float NewerTime = FrameTimes[Frames.Newer];
+	Frames.Alpha = NewerTime > OlderTime ? (Time - OlderTime) / (NewerTime - OlderTime) : 1.f;
+
+	return Frames;
+}
+
+FVector FCharacterPositionHistory::GetLocation(const AMyNetCharacter* Character, const FPositionHistoryFrames& Frames) const
+{
+	const int32* Slot = Frames.Newer != INDEX_NONE ? SlotIndices.Find(Character) : nullptr;
+	if (!Slot)
+	{
+		return Character->GetActorLocation();
+	}
+
+	// A frame from before the character got its slot holds the location of someone else
+	const uint32 FirstSerial = SlotFirstSerials[*Slot];
+	const bool bOlderValid = FrameSerials[Frames.Older] >= FirstSerial;
+	const bool bNewerValid = FrameSerials[Frames.Newer] >= FirstSerial;
+
+	if (!bNewerValid)
+	{
+		return Character->GetActorLocation();
+	}
+
+	const int32 NewerIndex = Frames.Newer * MaxCharacters + *Slot;
+	const FVector NewerLocation(X[NewerIndex], Y[NewerIndex], Z[NewerIndex]);
+	if (!bOlderValid)
+	{
+		return NewerLocation;
+	}
+
+	const int32 OlderIndex = Frames.Older * MaxCharacters + *Slot;
+	const FVector OlderLocation(X[OlderIndex], Y[OlderIndex], Z[OlderIndex]);
+
+	return FMath::Lerp(OlderLocation, NewerLocation, Frames.Alpha);
+}
+
+uint32 FCharacterPositionHistory::GetAllocatedSize() const
+{
+	return X.GetAllocatedSize() + Y.GetAllocatedSize() + Z.GetAllocatedSize() + FrameTimes.GetAllocatedSize() + FrameSerials.GetAllocatedSize()
+		+ SlotCharacters.GetAllocatedSize() + SlotFirstSerials.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + SlotIndices.GetAllocatedSize();
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AMyNetCharacter;
+
+/** The two recorded frames around a rewind time, found once per rewind and shared by all its lookups */
+struct FPositionHistoryFrames
+{
+	/** Ring indices of the frames, INDEX_NONE if there is nothing to rewind to */
+	int32 Older = INDEX_NONE;
+	int32 Newer = INDEX_NONE;
+
+	/** Blend from Older to Newer */
+	float Alpha = 0.f;
+};
+
+/**
+* Fixed size ring of the character locations of the last server frames, for lag compensation.
+* Stored as a structure of arrays: one row of X, one of Y and one of Z per frame, with a column
+* per character slot. Recording writes three contiguous rows and a rewind reads two rows per victim.
+* Everything is allocated in Init, recording and rewinding never allocate.
+*/
+class MYNET_API FCharacterPositionHistory
+{
+public:
+	/** Allocates the ring. Forgets the recorded frames and characters */
+	void Init(int32 InMaxCharacters, int32 InNumFrames);
+
+	/** Gives a character a slot. Returns false if all the slots are taken, the character then never gets rewound */
+	bool Add(AMyNetCharacter* Character);
+
+	/** Frees the slot of a character */
+	void Remove(AMyNetCharacter* Character);
+
+	/** Records the location of every character with a slot */
+	void Record(float Time);
+
+	/** Finds the frames around Time. Times past the newest frame return no frames, older ones are clamped to the oldest */
+	FPositionHistoryFrames FindFrames(float Time) const;
+
+	/** Returns the interpolated location of a character, or its current location if it wasn't recorded in the frames */
+	FVector GetLocation(const AMyNetCharacter* Character, const FPositionHistoryFrames& Frames) const;
+
+	/** Returns the number of characters with a slot */
+	int32 Num() const { return SlotIndices.Num(); }
+
+	/** Returns the memory used by the ring */
+	uint32 GetAllocatedSize() const;
+
+private:
+	/** Returns the ring index of the frame Age frames back, 0 being the newest */
+	int32 GetFrameIndex(int32 Age) const { return (NextFrame - 1 - Age + NumFrames) % NumFrames; }
+
+	int32 MaxCharacters = 0;
+	int32 NumFrames = 0;
+
+	/** Ring index of the next frame to record, and the number of frames recorded so far */
+	int32 NextFrame = 0;
+	uint32 NumRecorded = 0;
+
+	/** The locations, indexed by Frame * MaxCharacters + Slot */
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+
+	/** Time and serial of every frame of the ring, the serial being the value of NumRecorded when it was written */
+	TArray<float> FrameTimes;
+	TArray<uint32> FrameSerials;
+
+	/** The character of every slot, and the serial of its first recorded frame */
+	TArray<AMyNetCharacter*> SlotCharacters;
+	TArray<uint32> SlotFirstSerials;
+
+	/** Free slots, and the slot of every character */
+	TArray<int32> FreeSlots;
+	TMap<const AMyNetCharacter*, int32> SlotIndices;
+};
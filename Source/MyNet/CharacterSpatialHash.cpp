@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CharacterSpatialHash.h"
+#include "MyNetCharacter.h"
+#include "Components/CapsuleComponent.h"
+
+FCharacterSpatialHash::FCharacterSpatialHash(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	InvCellSize = 1.f / CellSize;
+}
+
+void FCharacterSpatialHash::SetCellSize(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	InvCellSize = 1.f / CellSize;
+
+	Cells.Reset();
+	for (FTrackedCharacter& Entry : Tracked)
+	{
+		Entry.Cell = GetCell(Entry.Character->GetActorLocation());
+		AddToCell(Entry.Character, Entry.Cell);
+	}
+}
+
+void FCharacterSpatialHash::Add(AMyNetCharacter* Character)
+{
+	check(Character);
+
+	MaxCharacterRadius = FMath::Max(MaxCharacterRadius, Character->GetCapsuleComponent()->GetScaledCapsuleRadius());
+
+	const FIntPoint Cell = GetCell(Character->GetActorLocation());
+	Tracked.Add({ Character, Cell });
+	AddToCell(Character, Cell);
+}
+
+void FCharacterSpatialHash::Remove(AMyNetCharacter* Character)
+{
+	const int32 Index = Tracked.IndexOfByPredicate([Character](const FTrackedCharacter& Entry) { return Entry.Character == Character; });
+	if (Index != INDEX_NONE)
+	{
+		RemoveFromCell(Character, Tracked[Index].Cell);
+		Tracked.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+void FCharacterSpatialHash::Update()
+{
+	for (FTrackedCharacter& Entry : Tracked)
+	{
+		const FIntPoint Cell = GetCell(Entry.Character->GetActorLocation());
+		if (Cell != Entry.Cell)
+		{
+			RemoveFromCell(Entry.Character, Entry.Cell);
+			AddToCell(Entry.Character, Cell);
+			Entry.Cell = Cell;
+		}
+	}
+}
+
+void FCharacterSpatialHash::Query(const FVector& Center, float Radius, TArray<AMyNetCharacter*>& OutCharacters) const
+{
+	const float Reach = Radius + MaxCharacterRadius;
+	const FIntPoint MinCell = GetCell(Center - FVector(Reach, Reach, 0.f));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Reach, Reach, 0.f));
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const TArray<AMyNetCharacter*>* Characters = Cells.Find(FIntPoint(X, Y));
+			if (!Characters)
+			{
+				continue;
+			}
+
+			for (AMyNetCharacter* Character : *Characters)
+			{
+				if (FVector::DistSquaredXY(Center, Character->GetActorLocation()) <= FMath::Square(Reach))
+				{
+					OutCharacters.Add(Character);
+				}
+			}
+		}
+	}
+}
+
+void FCharacterSpatialHash::AddToCell(AMyNetCharacter* Character, const FIntPoint& Cell)
+{
+	Cells.FindOrAdd(Cell).Add(Character);
+}
+
+void FCharacterSpatialHash::RemoveFromCell(AMyNetCharacter* Character, const FIntPoint& Cell)
+{
+	if (TArray<AMyNetCharacter*>* Characters = Cells.Find(Cell))
+	{
+		// Empty cells are kept, characters tend to come back to the same places
+		Characters->RemoveSingleSwap(Character, false);
+	}
+}
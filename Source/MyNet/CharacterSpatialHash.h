@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AMyNetCharacter;
+
+/**
+* Uniform 2D grid of characters, used to find the characters around a point
+* without going through the physics scene. Characters are only moved between
+* cells when they cross a cell border.
+*/
+class MYNET_API FCharacterSpatialHash
+{
+public:
+	explicit FCharacterSpatialHash(float InCellSize = 1000.f);
+
+	/** Changes the cell size, rebuilding the grid */
+	void SetCellSize(float InCellSize);
+
+	/** Starts tracking a character */
+	void Add(AMyNetCharacter* Character);
+
+	/** Stops tracking a character */
+	void Remove(AMyNetCharacter* Character);
+
+	/** Moves the characters that changed cell since the last update */
+	void Update();
+
+	/**
+	* Appends the characters that may be within Radius of Center (ignoring Z).
+	* The search is padded by the widest capsule, callers do the exact test
+	*/
+	void Query(const FVector& Center, float Radius, TArray<AMyNetCharacter*>& OutCharacters) const;
+
+	/** Returns the number of tracked characters */
+	int32 Num() const { return Tracked.Num(); }
+
+private:
+	struct FTrackedCharacter
+	{
+		AMyNetCharacter* Character;
+		FIntPoint Cell;
+	};
+
+	/** Returns the cell a location falls into */
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X * InvCellSize), FMath::FloorToInt(Location.Y * InvCellSize));
+	}
+
+	void AddToCell(AMyNetCharacter* Character, const FIntPoint& Cell);
+	void RemoveFromCell(AMyNetCharacter* Character, const FIntPoint& Cell);
+
+	float CellSize;
+	float InvCellSize;
+
+	/** The widest capsule radius among the tracked characters */
+	float MaxCharacterRadius = 0.f;
+
+	/** The characters of every non empty cell */
+	TMap<FIntPoint, TArray<AMyNetCharacter*>> Cells;
+
+	/** Every tracked character with the cell it is currently filed under */
+	TArray<FTrackedCharacter> Tracked;
+};
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CosmeticEventManager.h"
+#include "MyNet.h"
+#include "MyNetPlayerController.h"
+#include "Engine/NetConnection.h"
+
+ACosmeticEventManager::ACosmeticEventManager()
+{
+	// Send after everything that could add events this frame
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	// Server only
+	SetReplicates(false);
+}
+
+void ACosmeticEventManager::AddEvent(ECosmeticEventType Type, const FVector& Location, UParticleSystem* Effect)
+{
+	// Merge with an event of the same kind at about the same place
+	for (const FCosmeticEvent& Event : PendingEvents)
+	{
+		if (Event.Type == Type && Event.Effect == Effect && FVector::DistSquared(Event.Location, Location) <= FMath::Square(DedupeDistance))
+		{
+			INC_DWORD_STAT(STAT_MyNet_CosmeticEventsMerged);
+			return;
+		}
+	}
+
+	FCosmeticEvent& Event = PendingEvents[PendingEvents.AddDefaulted()];
+	Event.Type = Type;
+	Event.Location = Location;
+	Event.Effect = Effect;
+}
+
+void ACosmeticEventManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_MEMORY_STAT(STAT_MyNet_CosmeticEventMemory, PendingEvents.GetAllocatedSize() + Bundle.GetAllocatedSize());
+
+	if (PendingEvents.Num() == 0)
+	{
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(It->Get());
+		if (!PlayerController)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		Bundle.Reset();
+		for (const FCosmeticEvent& Event : PendingEvents)
+		{
+			if (FVector::DistSquared(Event.Location, ViewLocation) <= FMath::Square(EventRadius))
+			{
+				Bundle.Add(Event);
+			}
+		}
+
+		if (Bundle.Num() == 0)
+		{
+			continue;
+		}
+
+		// A saturated connection has more important things to send
+		UNetConnection* Connection = PlayerController->GetNetConnection();
+		if (Connection && !PlayerController->IsLocalController() && !Connection->IsNetReady(false))
+		{
+			INC_DWORD_STAT_BY(STAT_MyNet_CosmeticEventsDropped, Bundle.Num());
+			continue;
+		}
+
+		// Keep the closest ones if there are too many
+		if (Bundle.Num() > MaxEventsPerBundle)
+		{
+			Bundle.Sort([&ViewLocation](const FCosmeticEvent& A, const FCosmeticEvent& B)
+			{
+				return FVector::DistSquared(A.Location, ViewLocation) < FVector::DistSquared(B.Location, ViewLocation);
+			});
+
+			INC_DWORD_STAT_BY(STAT_MyNet_CosmeticEventsDropped, Bundle.Num() - MaxEventsPerBundle);
+			Bundle.SetNum(MaxEventsPerBundle, false);
+		}
+
+		INC_DWORD_STAT_BY(STAT_MyNet_CosmeticEventsSent, Bundle.Num());
+		PlayerController->ClientReceiveCosmeticEvents(Bundle);
+	}
+
+	PendingEvents.Reset();
+}
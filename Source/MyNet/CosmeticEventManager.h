@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "CosmeticEventManager.generated.h"
+
+class UParticleSystem;
+
+/** What a cosmetic event shows */
+UENUM()
+enum class ECosmeticEventType : uint8
+{
+	Explosion
+};
+
+/** Something purely visual that happened on the server */
+USTRUCT()
+struct FCosmeticEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	ECosmeticEventType Type = ECosmeticEventType::Explosion;
+
+	/** The effect to play */
+	UPROPERTY()
+	UParticleSystem* Effect = nullptr;
+};
+
+/**
+* Collects the cosmetic events of a frame and sends every player one unreliable bundle
+* with the events around them, instead of a reliable multicast per event to everyone.
+* Events close to each other are merged, and saturated connections skip the bundle. Server only.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API ACosmeticEventManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ACosmeticEventManager();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Queues an event for the bundles of this frame */
+	void AddEvent(ECosmeticEventType Type, const FVector& Location, UParticleSystem* Effect);
+
+	/** Returns how far from an event the players still get it */
+	float GetEventRadius() const { return EventRadius; }
+
+protected:
+	/** Players further than this from an event don't get it */
+	UPROPERTY(Config, EditAnywhere, Category = CosmeticEvents)
+	float EventRadius = 5000.f;
+
+	/** Events of the same kind closer than this are sent as one */
+	UPROPERTY(Config, EditAnywhere, Category = CosmeticEvents)
+	float DedupeDistance = 50.f;
+
+	/** A bundle never carries more than this, the furthest events are dropped */
+	UPROPERTY(Config, EditAnywhere, Category = CosmeticEvents)
+	int32 MaxEventsPerBundle = 32;
+
+private:
+	/** The events of this frame */
+	TArray<FCosmeticEvent> PendingEvents;
+
+	/** Scratch bundle, reused for every player */
+	TArray<FCosmeticEvent> Bundle;
+};
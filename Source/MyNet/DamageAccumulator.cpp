@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DamageAccumulator.h"
+#include "MyNet.h"
+#include "MyNetProfiler.h"
+#include "MyNetCharacter.h"
+#include "GameFramework/DamageType.h"
+
+ADamageAccumulator::ADamageAccumulator()
+{
+	// Last thing of the frame, after the explosions and the timers dealt their damage
+	// but before the net driver replicates the stats
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_LastDemotable;
+
+	// Server only
+	SetReplicates(false);
+}
+
+void ADamageAccumulator::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_MEMORY_STAT(STAT_MyNet_DamageAccumulatorMemory, Victims.GetAllocatedSize() + VictimIndices.GetAllocatedSize());
+
+	Flush();
+}
+
+void ADamageAccumulator::AddDamage(AMyNetCharacter* Victim, float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	FDamageHit Hit;
+	Hit.Damage = Damage;
+	Hit.DamageType = DamageEvent.DamageTypeClass;
+	Hit.EventInstigator = EventInstigator;
+	Hit.DamageCauser = DamageCauser;
+
+	if (const int32* VictimIndex = VictimIndices.Find(Victim))
+	{
+		FVictimDamage& Entry = Victims[*VictimIndex];
+		Entry.Damage += Damage;
+		Entry.NumHits++;
+
+		INC_DWORD_STAT(STAT_MyNet_DamageHitsCoalesced);
+
+		// The hits are taken in arrival order, so the same hits always credit the same killer
+		if (!Entry.bKilled && Entry.Damage >= Entry.StartHealth)
+		{
+			Entry.KillingHit = Hit;
+			Entry.bKilled = true;
+		}
+
+		if (Damage > Entry.MainHit.Damage)
+		{
+			Entry.MainHit = Hit;
+		}
+		return;
+	}
+
+	FVictimDamage Entry;
+	Entry.Character = Victim;
+	Entry.StartHealth = Victim->GetHealth();
+	Entry.Damage = Damage;
+	Entry.NumHits = 1;
+	Entry.bKilled = Damage >= Entry.StartHealth;
+	Entry.KillingHit = Hit;
+	Entry.MainHit = Hit;
+
+	VictimIndices.Add(Victim, Victims.Add(Entry));
+}
+
+void ADamageAccumulator::Flush()
+{
+	if (Victims.Num() == 0)
+	{
+		return;
+	}
+
+	// The actual damage of the TakeDamage calls of the frame
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_TakeDamage, TakeDamage);
+
+	// Applying damage can lead to more damage, which then waits for the next frame
+	TArray<FVictimDamage> FrameVictims = MoveTemp(Victims);
+	Victims.Reset();
+	VictimIndices.Reset();
+
+	for (const FVictimDamage& Entry : FrameVictims)
+	{
+		AMyNetCharacter* Character = Entry.Character.Get();
+		if (!Character || Character->IsPendingKill())
+		{
+			continue;
+		}
+
+		const FDamageHit& CreditedHit = Entry.bKilled ? Entry.KillingHit : Entry.MainHit;
+		const FDamageEvent DamageEvent(CreditedHit.DamageType ? CreditedHit.DamageType : TSubclassOf<UDamageType>(UDamageType::StaticClass()));
+
+		Character->ApplyDamage(Entry.Damage, DamageEvent, CreditedHit.EventInstigator.Get(), CreditedHit.DamageCauser.Get());
+	}
+}
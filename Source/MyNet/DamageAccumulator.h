@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "DamageAccumulator.generated.h"
+
+class AMyNetCharacter;
+
+/**
+* Server side collection of the damage the characters take during a frame.
+* Every hit is only recorded when it happens. At the end of the frame each victim gets
+* the sum of its hits in one go, so the health change, the respawn, the text update and
+* the replication of the stats happen once per victim and frame however many hits it took.
+*/
+UCLASS(notplaceable)
+class MYNET_API ADamageAccumulator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ADamageAccumulator();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Records a hit, applied with the others of the frame on the next Flush */
+	void AddDamage(AMyNetCharacter* Victim, float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+
+	/** Applies the recorded hits, one update per victim */
+	void Flush();
+
+private:
+	/** A single recorded hit */
+	struct FDamageHit
+	{
+		float Damage = 0.f;
+		TSubclassOf<class UDamageType> DamageType;
+		TWeakObjectPtr<AController> EventInstigator;
+		TWeakObjectPtr<AActor> DamageCauser;
+	};
+
+	/** The hits of a frame on one victim */
+	struct FVictimDamage
+	{
+		TWeakObjectPtr<AMyNetCharacter> Character;
+
+		/** Health of the victim before the first hit of the frame */
+		float StartHealth;
+
+		float Damage;
+
+		int32 NumHits;
+
+		/** The hit that took the health down to 0, credited with the kill */
+		FDamageHit KillingHit;
+		bool bKilled;
+
+		/** The biggest hit, earliest on ties. Credited when nobody got the kill */
+		FDamageHit MainHit;
+	};
+
+	/** The victims of this frame, in the order of their first hit */
+	TArray<FVictimDamage> Victims;
+
+	TMap<AMyNetCharacter*, int32> VictimIndices;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DirtyReplication.h"
+#include "MyNet.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+
+static TAutoConsoleVariable<float> CVarDirtyRefreshInterval(
+	TEXT("mynet.DirtyRefreshInterval"),
+	1.f,
+	TEXT("Seconds after which dirty flag guarded properties get compared again even if not marked, so late channels catch up"),
+	ECVF_Default);
+
+/** Returns the number of client connections with a channel open for the actor */
+static int32 CountOpenChannels(AActor* Actor)
+{
+	int32 NumChannels = 0;
+	if (UNetDriver* NetDriver = Actor->GetNetDriver())
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection && Connection->ActorChannels.Contains(Actor))
+			{
+				NumChannels++;
+			}
+		}
+	}
+
+	return NumChannels;
+}
+
+bool FDirtyReplicationFlag::Consume(AActor* Owner, int32 NumProperties)
+{
+	// Only counted while a change is out, the flag stays cheap for the owners that rarely change
+	if (bPending && NumReplicated >= CountOpenChannels(Owner))
+	{
+		bPending = false;
+	}
+
+	bPending |= bDirty;
+	bDirty = false;
+	NumReplicated = 0;
+
+	const float TimeSeconds = Owner->GetWorld()->GetTimeSeconds();
+	const bool bActive = bPending || TimeSeconds - LastActiveTime >= CVarDirtyRefreshInterval.GetValueOnGameThread();
+
+	if (bActive)
+	{
+		LastActiveTime = TimeSeconds;
+	}
+	else
+	{
+		INC_DWORD_STAT_BY(STAT_MyNet_SkippedPropertyCompares, NumProperties);
+	}
+
+	return bActive;
+}
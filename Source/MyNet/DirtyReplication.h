@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+* Dirty flag for replicated properties that only change at a few known places.
+* Owners mark it when they change those properties and use the result of Consume
+* with DOREPLIFETIME_ACTIVE_OVERRIDE in PreReplication, so the properties are not
+* compared at all on the net updates where nothing happened.
+* A change stays active until a net update replicated the owner on every channel it
+* has open, so connections starved by the bandwidth limit still get it. Owners report
+* each channel from ReplicateSubobjects with NotifyReplicated.
+*
+* Inactive properties are not sent to newly opened channels either, so the flag
+* also turns itself on every mynet.DirtyRefreshInterval seconds.
+*/
+struct MYNET_API FDirtyReplicationFlag
+{
+	/** Call whenever one of the guarded properties changes */
+	void Mark() { bDirty = true; }
+
+	/** Call from ReplicateSubobjects, once for every channel the owner got replicated on */
+	void NotifyReplicated() { NumReplicated++; }
+
+	/**
+	* Returns true if the guarded properties should be compared this net update.
+	* Clears the changes the previous net update replicated on every open channel of Owner.
+	* @param NumProperties	The number of guarded properties, for the skipped comparison stat
+	*/
+	bool Consume(AActor* Owner, int32 NumProperties);
+
+private:
+	/** Marked since the last net update */
+	bool bDirty = true;
+
+	/** Marked before the last net update and not replicated on every channel yet */
+	bool bPending = false;
+
+	/** Channels replicated on since the last net update */
+	int32 NumReplicated = 0;
+
+	float LastActiveTime = -BIG_NUMBER;
+};
@@ -0,0 +1,475 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ExplosionManager.h"
+#include "MyNet.h"
+#include "MyNetProfiler.h"
+#include "MyNetCharacter.h"
+#include "MyNetGameMode.h"
+#include "MatchEventLog.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "EngineUtils.h"
+
+/** Returns the distance between a point and the capsule of a character standing at Location, 0 if inside */
+static float GetDistanceToCapsule(const FVector& Origin, const AMyNetCharacter* Character, const FVector& Location)
+{
+	const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+
+	// Closest point of the capsule segment
+	const FVector SegmentPoint(Location.X, Location.Y, FMath::Clamp(Origin.Z, Location.Z - HalfHeight, Location.Z + HalfHeight));
+
+	return FMath::Max(FVector::Dist(Origin, SegmentPoint) - Capsule->GetScaledCapsuleRadius(), 0.f);
+}
+
+/** Returns the params of the line of sight test between an explosion and a character */
+static FCollisionQueryParams GetVisibilityParams(const FQueuedExplosion& Explosion, AMyNetCharacter* Character)
+{
+	FCollisionQueryParams LineParams(FName(TEXT("ExplosionVisibility")), true, Character);
+	if (AActor* DamageCauser = Explosion.DamageCauser.Get())
+	{
+		LineParams.AddIgnoredActor(DamageCauser);
+	}
+
+	return LineParams;
+}
+
+AExplosionManager::AExplosionManager()
+{
+	// Resolve after the timers fired, so the explosions of this frame are resolved in this frame
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	// Server only
+	SetReplicates(false);
+}
+
+void AExplosionManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SpatialHash.SetCellSize(CellSize);
+
+	// The characters registered before BeginPlay lose their slot here, give it back
+	PositionHistory.Init(MaxHistoryCharacters, HistoryFrames);
+	for (TActorIterator<AMyNetCharacter> It(GetWorld()); It; ++It)
+	{
+		if (It->Role == ROLE_Authority && !It->IsPendingKill())
+		{
+			PositionHistory.Add(*It);
+		}
+	}
+}
+
+void AExplosionManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// The characters moved during the frame, record where they ended before resolving against it
+	if (bLagCompensation)
+	{
+		PositionHistory.Record(GetWorld()->GetTimeSeconds());
+	}
+
+	// The traces started last frame ran at the end of it, first free them for the explosions of this frame
+	const double ConsumeStartTime = FPlatformTime::Seconds();
+	ConsumeVisibilityTraces();
+
+	if (AsyncTraceBench.bTracesStarted)
+	{
+		AsyncTraceBench.ReadSeconds += FPlatformTime::Seconds() - ConsumeStartTime;
+		AsyncTraceBench.bTracesStarted = false;
+	}
+
+	ResolveExplosions(true, bAsyncVisibility);
+
+	// After the explosions of the frame, so they don't mix with the ones of the benchmark
+	if (AsyncTraceBench.NumExplosions > 0)
+	{
+		TickAsyncTraceBench();
+	}
+
+	SET_MEMORY_STAT(STAT_MyNet_ExplosionQueueMemory, PendingExplosions.GetAllocatedSize() + Victims.GetAllocatedSize() + VictimIndices.GetAllocatedSize() + QueryResults.GetAllocatedSize()
+		+ PositionHistory.GetAllocatedSize() + TracedExplosions.GetAllocatedSize() + PendingTraces.GetAllocatedSize());
+}
+
+void AExplosionManager::AddExplosion(const FVector& Origin, float Radius, float Damage, AActor* DamageCauser, AController* EventInstigator)
+{
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (AMatchEventRecorder* EventRecorder = GameMode ? GameMode->GetEventRecorder() : nullptr)
+	{
+		EventRecorder->RecordExplosion(Origin, Radius, Damage, DamageCauser, EventInstigator);
+	}
+
+	if (!bBatchExplosions)
+	{
+		MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RadialDamage, RadialDamage);
+
+		// Do not ignore any actors
+		TArray<AActor*> IgnoreActors;
+
+		UGameplayStatics::ApplyRadialDamage(GetWorld(), Damage, Origin, Radius, UDamageType::StaticClass(), IgnoreActors, DamageCauser, EventInstigator);
+		return;
+	}
+
+	QueueExplosion(Origin, Radius, Damage, DamageCauser, EventInstigator);
+}
+
+void AExplosionManager::QueueExplosion(const FVector& Origin, float Radius, float Damage, AActor* DamageCauser, AController* EventInstigator)
+{
+	PendingExplosions.Add({ Origin, Radius, Damage, DamageCauser, EventInstigator, GetRewindTime(EventInstigator) });
+}
+
+float AExplosionManager::GetRewindTime(AController* EventInstigator) const
+{
+	// Bots and the players of a listen server see the characters where the server has them
+	const APlayerController* PlayerController = Cast<APlayerController>(EventInstigator);
+	if (!bLagCompensation || !PlayerController || PlayerController->IsLocalController() || !PlayerController->PlayerState)
+	{
+		return 0.f;
+	}
+
+	// The predicted bomb went off half a round trip before this one, showing the characters another half behind the server
+	const float RewindTime = PlayerController->PlayerState->ExactPing * 0.001f + ProxyInterpolationDelay;
+	return FMath::Clamp(RewindTime, 0.f, MaxRewindTime);
+}
+
+void AExplosionManager::RegisterCharacter(AMyNetCharacter* Character)
+{
+	SpatialHash.Add(Character);
+	PositionHistory.Add(Character);
+}
+
+void AExplosionManager::UnregisterCharacter(AMyNetCharacter* Character)
+{
+	SpatialHash.Remove(Character);
+	PositionHistory.Remove(Character);
+}
+
+int32 AExplosionManager::ResolveExplosions(bool bApplyDamage, bool bAsyncTraces)
+{
+	if (PendingExplosions.Num() == 0)
+	{
+		return 0;
+	}
+
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RadialDamage, RadialDamage);
+
+	SpatialHash.Update();
+
+	Victims.Reset();
+	VictimIndices.Reset();
+
+	UWorld* World = GetWorld();
+	const float CurrentTime = World->GetTimeSeconds();
+
+	// Traces of an earlier call still waiting for their results, resolved on the spot instead
+	bAsyncTraces &= TracedExplosions.Num() == 0;
+
+	// Gather every victim of every explosion, summing up the damage
+	for (int32 ExplosionIndex = 0; ExplosionIndex < PendingExplosions.Num(); ExplosionIndex++)
+	{
+		const FQueuedExplosion& Explosion = PendingExplosions[ExplosionIndex];
+		const bool bRewind = bLagCompensation && Explosion.RewindTime > 0.f;
+
+		// The frames are found once per explosion, each victim then only blends two recorded locations
+		const FPositionHistoryFrames Frames = bRewind ? PositionHistory.FindFrames(CurrentTime - Explosion.RewindTime) : FPositionHistoryFrames();
+
+		// The hash has the current locations, search wide enough for where the characters were
+		QueryResults.Reset();
+		SpatialHash.Query(Explosion.Origin, Explosion.Radius + (bRewind ? Explosion.RewindTime * MaxRewindSpeed : 0.f), QueryResults);
+
+		for (AMyNetCharacter* Character : QueryResults)
+		{
+			const FVector Location = bRewind ? PositionHistory.GetLocation(Character, Frames) : Character->GetActorLocation();
+
+			if (GetDistanceToCapsule(Explosion.Origin, Character, Location) > Explosion.Radius)
+			{
+				continue;
+			}
+
+			// All the tests of the frame go to the async trace task together, the victims are known next frame
+			if (bAsyncTraces)
+			{
+				const FTraceHandle Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Test, Explosion.Origin, Location, ECC_Visibility, GetVisibilityParams(Explosion, Character));
+				PendingTraces.Add({ Handle, Character, Location, ExplosionIndex });
+				continue;
+			}
+
+			if (!IsVisibleFrom(Explosion, Character, Location))
+			{
+				continue;
+			}
+
+			if (bRewind)
+			{
+				INC_DWORD_STAT(STAT_MyNet_RewoundHits);
+			}
+
+			AddVictim(Character, PendingExplosions, ExplosionIndex);
+		}
+	}
+
+	if (bAsyncTraces)
+	{
+		INC_DWORD_STAT_BY(STAT_MyNet_AsyncVisibilityTraces, PendingTraces.Num());
+
+		// Kept until the results are in, the swap hands the emptied array back for the next frame
+		Swap(TracedExplosions, PendingExplosions);
+		bApplyTracedDamage = bApplyDamage;
+	}
+	else if (bApplyDamage)
+	{
+		ApplyVictimDamage(PendingExplosions);
+	}
+
+	PendingExplosions.Reset();
+
+	return Victims.Num();
+}
+
+int32 AExplosionManager::ConsumeVisibilityTraces()
+{
+	if (TracedExplosions.Num() == 0)
+	{
+		return 0;
+	}
+
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RadialDamage, RadialDamage);
+
+	Victims.Reset();
+	VictimIndices.Reset();
+
+	UWorld* World = GetWorld();
+	FTraceDatum TraceData;
+
+	for (const FPendingVisibilityTrace& Trace : PendingTraces)
+	{
+		// Destroyed in between, dead characters are dealt with by TakeDamage
+		AMyNetCharacter* Character = Trace.Character.Get();
+		if (!Character)
+		{
+			continue;
+		}
+
+		const FQueuedExplosion& Explosion = TracedExplosions[Trace.Explosion];
+
+		const bool bVisible = World->QueryTraceData(Trace.Handle, TraceData)
+			? FHitResult::GetFirstBlockingHit(TraceData.OutHits) == nullptr
+			: IsVisibleFrom(Explosion, Character, Trace.Location);
+
+		if (!bVisible)
+		{
+			continue;
+		}
+
+		if (bLagCompensation && Explosion.RewindTime > 0.f)
+		{
+			INC_DWORD_STAT(STAT_MyNet_RewoundHits);
+		}
+
+		AddVictim(Character, TracedExplosions, Trace.Explosion);
+	}
+
+	if (bApplyTracedDamage)
+	{
+		ApplyVictimDamage(TracedExplosions);
+	}
+
+	TracedExplosions.Reset();
+	PendingTraces.Reset();
+
+	return Victims.Num();
+}
+
+void AExplosionManager::AddVictim(AMyNetCharacter* Character, const TArray<FQueuedExplosion>& Explosions, int32 ExplosionIndex)
+{
+	const FQueuedExplosion& Explosion = Explosions[ExplosionIndex];
+
+	// The character takes the full damage, the same as with ApplyRadialDamage since TakeDamage ignores the falloff
+	if (const int32* VictimIndex = VictimIndices.Find(Character))
+	{
+		FVictimDamage& Victim = Victims[*VictimIndex];
+		Victim.Damage += Explosion.Damage;
+
+		// Strictly greater, so ties go to the earliest explosion and the result doesn't depend on ordering of the hash
+		if (Explosion.Damage > Victim.MainExplosionDamage)
+		{
+			Victim.MainExplosion = ExplosionIndex;
+			Victim.MainExplosionDamage = Explosion.Damage;
+		}
+	}
+	else
+	{
+		VictimIndices.Add(Character, Victims.Num());
+		Victims.Add({ Character, Explosion.Damage, ExplosionIndex, Explosion.Damage });
+	}
+}
+
+void AExplosionManager::ApplyVictimDamage(const TArray<FQueuedExplosion>& Explosions)
+{
+	for (const FVictimDamage& Victim : Victims)
+	{
+		const FQueuedExplosion& MainExplosion = Explosions[Victim.MainExplosion];
+		const FDamageEvent DamageEvent(UDamageType::StaticClass());
+
+		Victim.Character->TakeDamage(Victim.Damage, DamageEvent, MainExplosion.EventInstigator.Get(), MainExplosion.DamageCauser.Get());
+	}
+}
+
+int32 AExplosionManager::ResolveExplosionsUnbatched()
+{
+	int32 NumHits = 0;
+
+	for (const FQueuedExplosion& Explosion : PendingExplosions)
+	{
+		// The same queries ApplyRadialDamage runs for every explosion
+		FCollisionQueryParams SphereParams(FName(TEXT("ExplosionOverlap")), false, Explosion.DamageCauser.Get());
+
+		TArray<FOverlapResult> Overlaps;
+		GetWorld()->OverlapMultiByObjectType(Overlaps, Explosion.Origin, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects), FCollisionShape::MakeSphere(Explosion.Radius), SphereParams);
+
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			AMyNetCharacter* Character = Cast<AMyNetCharacter>(Overlap.GetActor());
+			if (Character && Overlap.Component == Character->GetCapsuleComponent() && IsVisibleFrom(Explosion, Character, Character->GetActorLocation()))
+			{
+				NumHits++;
+			}
+		}
+	}
+
+	PendingExplosions.Reset();
+
+	return NumHits;
+}
+
+bool AExplosionManager::IsVisibleFrom(const FQueuedExplosion& Explosion, AMyNetCharacter* Character, const FVector& Location) const
+{
+	return !GetWorld()->LineTraceTestByChannel(Explosion.Origin, Location, ECC_Visibility, GetVisibilityParams(Explosion, Character));
+}
+
+void AExplosionManager::QueueBenchExplosions(const TArray<FVector>& Targets, int32 NumExplosions, int32 Seed)
+{
+	FRandomStream Random(Seed);
+	for (int32 Index = 0; Index < NumExplosions; Index++)
+	{
+		const FVector Origin = Targets[Random.RandHelper(Targets.Num())] + Random.GetUnitVector() * Random.FRandRange(0.f, 300.f);
+		QueueExplosion(Origin, 200.f, 25.f, nullptr, nullptr);
+	}
+}
+
+void AExplosionManager::StartAsyncTraceBench(const TArray<FVector>& Targets, int32 MaxExplosions, int32 Iterations)
+{
+	AsyncTraceBench = FAsyncTraceBench();
+	AsyncTraceBench.Targets = Targets;
+	AsyncTraceBench.NumExplosions = 1;
+	AsyncTraceBench.MaxExplosions = MaxExplosions;
+	AsyncTraceBench.Iterations = FMath::Max(Iterations, 1);
+}
+
+void AExplosionManager::TickAsyncTraceBench()
+{
+	FAsyncTraceBench& Bench = AsyncTraceBench;
+
+	// The traces of the explosions of this frame are in the way, which would resolve the benchmark on the spot
+	if (TracedExplosions.Num() > 0)
+	{
+		return;
+	}
+
+	if (Bench.Iteration == Bench.Iterations)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("%5d explosions: async traces %8.3f ms when started, %8.3f ms the next frame, %8.3f ms in all"), Bench.NumExplosions,
+			1000.0 * Bench.StartSeconds / Bench.Iterations, 1000.0 * Bench.ReadSeconds / Bench.Iterations, 1000.0 * (Bench.StartSeconds + Bench.ReadSeconds) / Bench.Iterations);
+
+		Bench.NumExplosions *= 2;
+		Bench.Iteration = 0;
+		Bench.StartSeconds = 0.0;
+		Bench.ReadSeconds = 0.0;
+
+		if (Bench.NumExplosions > Bench.MaxExplosions)
+		{
+			Bench.NumExplosions = 0;
+			return;
+		}
+	}
+
+	// Same explosions as the synchronous paths
+	QueueBenchExplosions(Bench.Targets, Bench.NumExplosions, Bench.Iteration);
+
+	const double StartTime = FPlatformTime::Seconds();
+	ResolveExplosions(false, true);
+	Bench.StartSeconds += FPlatformTime::Seconds() - StartTime;
+
+	// Read by the next Tick, once the async trace task ran them at the end of this frame
+	Bench.bTracesStarted = true;
+	Bench.Iteration++;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchExplosionsCmd(
+	TEXT("mynet.BenchExplosions"),
+	TEXT("mynet.BenchExplosions [MaxExplosions=256] [Iterations=20]. Times the batched explosion resolution against one query per explosion, for growing numbers of simultaneous explosions. Then, over the next frames, the game thread parts of the batched resolution with async line of sight tests, starting the traces and reading them the frame after. No damage is applied"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		TActorIterator<AExplosionManager> It(World);
+		if (!It)
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("mynet.BenchExplosions: no explosion manager, run it on the server"));
+			return;
+		}
+		AExplosionManager* Manager = *It;
+
+		const int32 MaxExplosions = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 256;
+		const int32 Iterations = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 20, 1);
+
+		// Explode around the characters, so there is something to hit
+		TArray<FVector> Targets;
+		for (TActorIterator<AMyNetCharacter> CharIt(World); CharIt; ++CharIt)
+		{
+			Targets.Add(CharIt->GetActorLocation());
+		}
+		if (Targets.Num() == 0)
+		{
+			Targets.Add(FVector::ZeroVector);
+		}
+
+		UE_LOG(LogMyNet, Log, TEXT("mynet.BenchExplosions: %d characters, %d iterations"), Manager->GetSpatialHash().Num(), Iterations);
+
+		for (int32 NumExplosions = 1; NumExplosions <= MaxExplosions; NumExplosions *= 2)
+		{
+			double BatchedSeconds = 0.0;
+			double UnbatchedSeconds = 0.0;
+
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+			{
+				// Same explosions for every path
+				for (int32 Pass = 0; Pass < 2; Pass++)
+				{
+					Manager->QueueBenchExplosions(Targets, NumExplosions, Iteration);
+
+					const double StartTime = FPlatformTime::Seconds();
+					if (Pass == 0)
+					{
+						Manager->ResolveExplosions(false);
+						BatchedSeconds += FPlatformTime::Seconds() - StartTime;
+					}
+					else
+					{
+						Manager->ResolveExplosionsUnbatched();
+						UnbatchedSeconds += FPlatformTime::Seconds() - StartTime;
+					}
+				}
+			}
+
+			UE_LOG(LogMyNet, Log, TEXT("%5d explosions: batched %8.3f ms, one by one %8.3f ms"), NumExplosions,
+				1000.0 * BatchedSeconds / Iterations, 1000.0 * UnbatchedSeconds / Iterations);
+		}
+
+		// The async traces only have their results the frame after they started, so that part takes a frame per iteration
+		UE_LOG(LogMyNet, Log, TEXT("mynet.BenchExplosions: timing the async traces over the next %d frames"), Iterations * (FMath::FloorLog2(FMath::Max(MaxExplosions, 1)) + 1));
+		Manager->StartAsyncTraceBench(Targets, MaxExplosions, Iterations);
+	}));
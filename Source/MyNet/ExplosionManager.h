@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "CharacterSpatialHash.h"
+#include "CharacterPositionHistory.h"
+#include "WorldCollision.h"
+#include "ExplosionManager.generated.h"
+
+class AMyNetCharacter;
+
+/** An explosion waiting to be resolved at the end of the frame */
+struct FQueuedExplosion
+{
+	FVector Origin;
+	float Radius;
+	float Damage;
+	TWeakObjectPtr<AActor> DamageCauser;
+	TWeakObjectPtr<AController> EventInstigator;
+
+	/** How far back the victims get rewound, 0 to hit them where they are now */
+	float RewindTime;
+};
+
+/** A line of sight test between an explosion and a possible victim, run by the async trace task of the world */
+struct FPendingVisibilityTrace
+{
+	FTraceHandle Handle;
+	TWeakObjectPtr<AMyNetCharacter> Character;
+
+	/** Where the character was tested, for the rare trace that has no result */
+	FVector Location;
+
+	/** Index of the explosion in the traced ones */
+	int32 Explosion;
+};
+
+/**
+* Server side resolution of the bomb explosions.
+* Explosions are queued during the frame and resolved all at once at the end of it, against
+* a spatial hash of the characters instead of a physics overlap per explosion.
+* Every victim then takes the summed damage of the frame in a single TakeDamage call.
+* The explosions of remote players are resolved against where their client saw the victims,
+* interpolated from a history of the character locations, see bLagCompensation.
+* With bAsyncVisibility the line of sight tests to the victims are handed to the async trace task
+* of the world as one batch, and the damage is applied the next frame when their results are in.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AExplosionManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AExplosionManager();
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Adds an explosion to resolve. Applies the damage right away if batching is off */
+	void AddExplosion(const FVector& Origin, float Radius, float Damage, AActor* DamageCauser, AController* EventInstigator);
+
+	/** Queues an explosion to be resolved at the end of the frame, whatever the config says */
+	void QueueExplosion(const FVector& Origin, float Radius, float Damage, AActor* DamageCauser, AController* EventInstigator);
+
+	/** Starts tracking a character as a possible victim */
+	void RegisterCharacter(AMyNetCharacter* Character);
+
+	/** Stops tracking a character */
+	void UnregisterCharacter(AMyNetCharacter* Character);
+
+	/**
+	* Resolves all the queued explosions.
+	* @param bApplyDamage	If false the victims are only gathered, used for benchmarking
+	* @param bAsyncTraces	If true the line of sight tests are only started, see ConsumeVisibilityTraces
+	* @return the number of damaged characters, 0 when the traces were started
+	*/
+	int32 ResolveExplosions(bool bApplyDamage = true, bool bAsyncTraces = false);
+
+	/**
+	* Damages the victims of the explosions whose line of sight tests were started by the previous frame.
+	* Tests without a result, the world not having ticked in between, are traced right away.
+	* @return the number of damaged characters
+	*/
+	int32 ConsumeVisibilityTraces();
+
+	/** Resolves the queued explosions one by one, the way ApplyRadialDamage would, without applying damage. Used for benchmarking */
+	int32 ResolveExplosionsUnbatched();
+
+	/** Returns the tracked characters */
+	const FCharacterSpatialHash& GetSpatialHash() const { return SpatialHash; }
+
+	/** Returns the recent locations of the tracked characters */
+	const FCharacterPositionHistory& GetPositionHistory() const { return PositionHistory; }
+
+	/**
+	* Times the batched resolution with async line of sight tests over the next frames, both the game thread
+	* part that starts the traces and the one that reads their results the frame after. Logs as it goes.
+	* No damage is applied. The async part of mynet.BenchExplosions
+	*/
+	void StartAsyncTraceBench(const TArray<FVector>& Targets, int32 MaxExplosions, int32 Iterations);
+
+	/** Queues NumExplosions explosions around Targets, the same ones for the same Seed. For benchmarking */
+	void QueueBenchExplosions(const TArray<FVector>& Targets, int32 NumExplosions, int32 Seed);
+
+	/** Returns how far back the victims of an explosion of this instigator get rewound */
+	float GetRewindTime(AController* EventInstigator) const;
+
+protected:
+	/** If false explosions are not queued and go through ApplyRadialDamage like before */
+	UPROPERTY(Config, EditAnywhere, Category = Explosions)
+	bool bBatchExplosions = true;
+
+	/** Size of a spatial hash cell. Best kept around the biggest explosion diameter */
+	UPROPERTY(Config, EditAnywhere, Category = Explosions)
+	float CellSize = 500.f;
+
+	/** If true the line of sight tests of the batched explosions run on the async trace task, delaying their damage by a frame */
+	UPROPERTY(Config, EditAnywhere, Category = Explosions)
+	bool bAsyncVisibility = false;
+
+	/** If true the explosions of remote players hit the victims where the player saw them */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	bool bLagCompensation = true;
+
+	/** Longest rewind, so players with a terrible connection can't hit characters that long left */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float MaxRewindTime = 0.3f;
+
+	/** How far behind the server clients show the other characters on top of the ping. Matches NetworkSimulatedSmoothLocationTime */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float ProxyInterpolationDelay = 0.1f;
+
+	/** Highest character speed, pads the victim search of rewound explosions */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float MaxRewindSpeed = 1200.f;
+
+	/** Frames kept by the position history. Has to cover MaxRewindTime at the highest server frame rate */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	int32 HistoryFrames = 64;
+
+	/** Characters the position history has room for, the others aren't rewound */
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	int32 MaxHistoryCharacters = 128;
+
+private:
+	/** Returns true if nothing blocks the line between the explosion and the character at Location */
+	bool IsVisibleFrom(const FQueuedExplosion& Explosion, AMyNetCharacter* Character, const FVector& Location) const;
+
+	/** Adds the damage of one of Explosions to a victim */
+	void AddVictim(AMyNetCharacter* Character, const TArray<FQueuedExplosion>& Explosions, int32 ExplosionIndex);
+
+	/** Applies the summed up damage, one TakeDamage per victim */
+	void ApplyVictimDamage(const TArray<FQueuedExplosion>& Explosions);
+
+	/** Starts the traces of the next iteration of the async trace benchmark, logs the finished sizes */
+	void TickAsyncTraceBench();
+
+	/** The explosions of this frame */
+	TArray<FQueuedExplosion> PendingExplosions;
+
+	/** The explosions of the previous frame, waiting for their line of sight tests */
+	TArray<FQueuedExplosion> TracedExplosions;
+	TArray<FPendingVisibilityTrace> PendingTraces;
+	bool bApplyTracedDamage = true;
+
+	/** The possible victims */
+	FCharacterSpatialHash SpatialHash;
+
+	/** Where the possible victims were during the last frames */
+	FCharacterPositionHistory PositionHistory;
+
+	// Scratch arrays, kept to avoid allocating each frame
+
+	struct FVictimDamage
+	{
+		AMyNetCharacter* Character;
+		float Damage;
+
+		/** The explosion that dealt most of the damage, credited with the hit */
+		int32 MainExplosion;
+		float MainExplosionDamage;
+	};
+
+	/** State of StartAsyncTraceBench, which needs a frame between starting the traces and reading them */
+	struct FAsyncTraceBench
+	{
+		TArray<FVector> Targets;
+
+		/** Explosions per iteration, 0 when not running */
+		int32 NumExplosions = 0;
+		int32 MaxExplosions = 0;
+		int32 Iterations = 0;
+		int32 Iteration = 0;
+
+		/** Set when the benchmark started traces that the next frame reads */
+		bool bTracesStarted = false;
+
+		double StartSeconds = 0.0;
+		double ReadSeconds = 0.0;
+	};
+
+	FAsyncTraceBench AsyncTraceBench;
+
+	TArray<FVictimDamage> Victims;
+	TMap<AMyNetCharacter*, int32> VictimIndices;
+	TArray<AMyNetCharacter*> QueryResults;
+};
@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HotPathBenchmark.h"
+#include "MyNet.h"
+#include "MyNetGameMode.h"
+#include "MyNetCharacter.h"
+#include "Bomb.h"
+#include "BombPool.h"
+#include "ExplosionManager.h"
+#include "DamageAccumulator.h"
+#include "StartupPreloader.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/** Calls per sample, so a sample lasts well over the timer resolution */
+static const int32 CallsPerSample = 16;
+
+/** Victim counts of the explosion benchmarks */
+static const int32 ExplosionVictims[] = { 0, 8, 32 };
+
+/**
+* Times NumSamples batches of CallsPerSample calls of Body, after a warm up batch.
+* Setup runs before and Cleanup after every batch, outside the timings.
+*/
+static FHotPathResult MeasurePath(const FString& Name, int32 NumSamples, TFunctionRef<void()> Setup, TFunctionRef<void(int32)> Body, TFunctionRef<void()> Cleanup)
+{
+	TArray<double> Samples;
+	Samples.Reserve(NumSamples);
+
+	for (int32 Sample = -1; Sample < NumSamples; Sample++)
+	{
+		Setup();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Call = 0; Call < CallsPerSample; Call++)
+		{
+			Body(Call);
+		}
+		const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+		Cleanup();
+
+		// The first batch only warms up the caches and pools
+		if (Sample >= 0)
+		{
+			Samples.Add(FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000000.0 / CallsPerSample);
+		}
+	}
+
+	Samples.Sort();
+
+	FHotPathResult Result;
+	Result.Name = Name;
+	Result.NumSamples = Samples.Num();
+	Result.MedianMicroseconds = Samples[Samples.Num() / 2];
+	Result.P95Microseconds = Samples[FMath::Min(FMath::FloorToInt(Samples.Num() * 0.95f), Samples.Num() - 1)];
+	return Result;
+}
+
+static void NoOp()
+{
+}
+
+void FHotPathBenchmark::RunAll(UWorld* World, int32 NumSamples, TArray<FHotPathResult>& OutResults)
+{
+	AMyNetGameMode* GameMode = World->GetAuthGameMode<AMyNetGameMode>();
+	if (!GameMode)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("FHotPathBenchmark: no AMyNetGameMode, run it on the server"));
+		return;
+	}
+
+	NumSamples = FMath::Max(NumSamples, 1);
+
+	// Measure the Blueprinted character, not the native one the game mode starts with
+	if (AStartupPreloader* StartupPreloader = GameMode->GetStartupPreloader())
+	{
+		StartupPreloader->WaitUntilLoaded();
+	}
+
+	UClass* CharacterClass = GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf<AMyNetCharacter>() ? *GameMode->DefaultPawnClass : AMyNetCharacter::StaticClass();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	// Far away from whatever the level holds
+	const FVector BenchOrigin(0.f, 0.f, -100000.f);
+
+	TArray<AActor*> SpawnedActors;
+	auto SpawnCharacter = [&](const FVector& Location)
+	{
+		AMyNetCharacter* Character = World->SpawnActor<AMyNetCharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParameters);
+		SpawnedActors.Add(Character);
+		return Character;
+	};
+
+	// Sends the bombs that are still around back to the pool, or destroys them
+	auto CleanupBombs = [World]()
+	{
+		for (TActorIterator<ABomb> It(World); It; ++It)
+		{
+			if (It->IsActive() && !It->IsCosmeticProxy())
+			{
+				It->FinishExplosion();
+			}
+		}
+	};
+
+	AMyNetCharacter* Thrower = SpawnCharacter(BenchOrigin);
+	if (!Thrower || !Thrower->BombActorBP)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("FHotPathBenchmark: %s can't throw bombs"), *CharacterClass->GetName());
+		return;
+	}
+
+	ABombPool* BombPool = GameMode->GetBombPool();
+	AExplosionManager* ExplosionManager = GameMode->GetExplosionManager();
+	ADamageAccumulator* DamageAccumulator = GameMode->GetDamageAccumulator();
+
+	// SpawnBomb, from the pool when there is one
+	OutResults.Add(MeasurePath(TEXT("SpawnBomb"), NumSamples,
+		[Thrower]() { Thrower->Stats.BombCount = CallsPerSample; },
+		[Thrower](int32) { Thrower->SpawnBomb(); },
+		CleanupBombs));
+
+	// Explode with growing numbers of characters in the blast, damage resolution included
+	const float ExplosionRadius = Thrower->BombActorBP->GetDefaultObject<ABomb>()->GetExplosionRadius();
+	TArray<ABomb*> Bombs;
+
+	for (int32 Index = 0; Index < ARRAY_COUNT(ExplosionVictims); Index++)
+	{
+		const int32 NumVictims = ExplosionVictims[Index];
+		const FVector Origin = BenchOrigin + FVector(100000.f * (Index + 1), 0.f, 0.f);
+
+		for (int32 Victim = 0; Victim < NumVictims; Victim++)
+		{
+			const FRotator Direction(0.f, 360.f * Victim / NumVictims, 0.f);
+			SpawnCharacter(Origin + Direction.Vector() * ExplosionRadius * 0.5f);
+		}
+
+		OutResults.Add(MeasurePath(FString::Printf(TEXT("Explode/%d"), NumVictims), NumSamples,
+			[&]()
+			{
+				Bombs.Reset();
+				for (int32 Call = 0; Call < CallsPerSample; Call++)
+				{
+					Bombs.Add(BombPool
+						? BombPool->AcquireBomb(Thrower->BombActorBP, Origin, FRotator::ZeroRotator, Thrower, nullptr)
+						: World->SpawnActor<ABomb>(Thrower->BombActorBP, Origin, FRotator::ZeroRotator, SpawnParameters));
+				}
+			},
+			[&](int32 Call)
+			{
+				if (ABomb* Bomb = Bombs[Call])
+				{
+					Bomb->Explode();
+				}
+				if (ExplosionManager)
+				{
+					ExplosionManager->ResolveExplosions();
+				}
+				if (DamageAccumulator)
+				{
+					DamageAccumulator->Flush();
+				}
+			},
+			CleanupBombs));
+	}
+
+	// TakeDamage, one hit per frame
+	OutResults.Add(MeasurePath(TEXT("TakeDamage"), NumSamples,
+		NoOp,
+		[&](int32)
+		{
+			Thrower->TakeDamage(1.f, FDamageEvent(), nullptr, nullptr);
+			if (DamageAccumulator)
+			{
+				DamageAccumulator->Flush();
+			}
+		},
+		NoOp));
+
+	OutResults.Add(MeasurePath(TEXT("UpdateCharText"), NumSamples,
+		NoOp,
+		[Thrower](int32) { Thrower->UpdateCharText(); },
+		NoOp));
+
+	// The part of the stats replication this module owns
+	OutResults.Add(MeasurePath(TEXT("StatsNetSerialize"), NumSamples,
+		NoOp,
+		[Thrower](int32)
+		{
+			FNetBitWriter Writer(nullptr, 64);
+			bool bSuccess = false;
+			Thrower->Stats.NetSerialize(Writer, nullptr, bSuccess);
+		},
+		NoOp));
+
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (Actor)
+		{
+			Actor->Destroy();
+		}
+	}
+}
+
+FString FHotPathBenchmark::GetBaselinePath()
+{
+	return FPaths::GameConfigDir() / TEXT("HotPathBaseline.csv");
+}
+
+int32 FHotPathBenchmark::CompareWithBaseline(const TArray<FHotPathResult>& Results, float Threshold)
+{
+	// Name,MedianMicroseconds per line, after the header
+	TMap<FString, double> Baseline;
+	TArray<FString> Lines;
+	if (FFileHelper::LoadANSITextFileToStrings(*GetBaselinePath(), nullptr, Lines))
+	{
+		for (int32 Index = 1; Index < Lines.Num(); Index++)
+		{
+			FString Name, Median;
+			if (Lines[Index].Split(TEXT(","), &Name, &Median))
+			{
+				Baseline.Add(Name, FCString::Atod(*Median));
+			}
+		}
+	}
+
+	int32 NumFailures = 0;
+
+	for (const FHotPathResult& Result : Results)
+	{
+		// Without a baseline a path could never fail, so that fails too
+		const double* BaselineMedian = Baseline.Find(Result.Name);
+		const bool bMissing = !BaselineMedian || *BaselineMedian <= 0.0;
+		const bool bRegressed = !bMissing && Result.MedianMicroseconds > *BaselineMedian * Threshold;
+
+		if (bMissing || bRegressed)
+		{
+			NumFailures++;
+		}
+
+		UE_LOG(LogMyNet, Log, TEXT("  %-20s median %9.3f us, p95 %9.3f us, baseline %s%s"),
+			*Result.Name, Result.MedianMicroseconds, Result.P95Microseconds,
+			BaselineMedian ? *FString::Printf(TEXT("%9.3f us"), *BaselineMedian) : TEXT("none"),
+			bMissing ? TEXT("  NO BASELINE") : bRegressed ? TEXT("  REGRESSED") : TEXT(""));
+	}
+
+	return NumFailures;
+}
+
+bool FHotPathBenchmark::WriteBaseline(const TArray<FHotPathResult>& Results)
+{
+	FString Text = TEXT("Name,MedianMicroseconds\n");
+	for (const FHotPathResult& Result : Results)
+	{
+		Text += FString::Printf(TEXT("%s,%.3f\n"), *Result.Name, Result.MedianMicroseconds);
+	}
+
+	return FFileHelper::SaveStringToFile(Text, *GetBaselinePath());
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchHotPathsCmd(
+	TEXT("mynet.BenchHotPaths"),
+	TEXT("mynet.BenchHotPaths [Samples=200] [Threshold=1.25] [WriteBaseline]. Times the bomb and damage hot paths and compares them with the checked in baseline, or writes it. Run it on the server"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumSamples = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+		const float Threshold = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 1.25f;
+
+		TArray<FHotPathResult> Results;
+		FHotPathBenchmark::RunAll(World, NumSamples, Results);
+
+		if (Args.Contains(TEXT("WriteBaseline")))
+		{
+			if (Results.Num() > 0 && FHotPathBenchmark::WriteBaseline(Results))
+			{
+				UE_LOG(LogMyNet, Log, TEXT("mynet.BenchHotPaths: wrote the baseline of %d paths to %s"), Results.Num(), *FHotPathBenchmark::GetBaselinePath());
+			}
+			return;
+		}
+
+		const int32 NumFailures = FHotPathBenchmark::CompareWithBaseline(Results, Threshold);
+		UE_LOG(LogMyNet, Log, TEXT("mynet.BenchHotPaths: %d paths, %d over %.2fx the baseline or without one"), Results.Num(), NumFailures, Threshold);
+	}));
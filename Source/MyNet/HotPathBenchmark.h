@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/** Timing of one benchmarked path, per call */
+struct FHotPathResult
+{
+	FString Name;
+	int32 NumSamples = 0;
+	double MedianMicroseconds = 0.0;
+	double P95Microseconds = 0.0;
+};
+
+/**
+* Micro benchmarks of the bomb and damage hot paths: SpawnBomb, ABomb::Explode with growing numbers
+* of victims, TakeDamage, UpdateCharText and the net serialization of the character stats.
+*
+* Every benchmark times a fixed number of samples of a fixed batch of calls, the setup of each sample
+* (bomb counts, bombs to explode) and the cleanup after it are left out of the timings.
+* The medians are compared with Config/HotPathBaseline.csv, recorded on the reference machine with WriteBaseline.
+* A path without a baseline entry fails like a regressed one, so new paths need a recorded baseline too.
+*
+* Run with mynet.BenchHotPaths in game, or headless with UBenchHotPathsCommandlet.
+*/
+struct MYNET_API FHotPathBenchmark
+{
+	/**
+	* Runs every benchmark. Spawns and removes characters and bombs, so World must be a server world
+	* with an AMyNetGameMode that nobody is playing in.
+	*/
+	static void RunAll(UWorld* World, int32 NumSamples, TArray<FHotPathResult>& OutResults);
+
+	/**
+	* Logs the results next to the baseline, returns the number of paths with a median over Threshold times
+	* the baseline or without a baseline
+	*/
+	static int32 CompareWithBaseline(const TArray<FHotPathResult>& Results, float Threshold);
+
+	/** Makes the results the new baseline */
+	static bool WriteBaseline(const TArray<FHotPathResult>& Results);
+
+	/** Where the baseline is checked in */
+	static FString GetBaselinePath();
+};
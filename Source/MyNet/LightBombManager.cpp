@@ -0,0 +1,255 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LightBombManager.h"
+#include "MyNet.h"
+#include "MyNetProfiler.h"
+#include "MyNetGameMode.h"
+#include "ExplosionManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/DamageType.h"
+
+// ---------------- Replicated entries
+// -----------------------------
+
+void FLightBombEntry::PostReplicatedAdd(const FLightBombArray& InArraySerializer)
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	InArraySerializer.Owner->OnBombAdded(*this);
+}
+
+void FLightBombEntry::PostReplicatedChange(const FLightBombArray& InArraySerializer)
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	InArraySerializer.Owner->OnBombChanged(*this);
+}
+
+void FLightBombEntry::PreReplicatedRemove(const FLightBombArray& InArraySerializer)
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	InArraySerializer.Owner->OnBombRemoved(*this);
+}
+
+bool FLightBombArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FLightBombEntry, FLightBombArray>(Items, DeltaParms, *this);
+
+	if (DeltaParms.Writer)
+	{
+		MYNET_INC_COUNTER(STAT_MyNet_LightBombBitsSent, LightBombBitsSent, (int32)(DeltaParms.Writer->GetNumBits() - StartBits));
+	}
+
+	return bResult;
+}
+
+// ---------------- Manager
+// -----------------------------
+
+ALightBombManager::ALightBombManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// Every client needs to know about every bomb, the same way they would see the bomb actors
+	SetReplicates(true);
+	bAlwaysRelevant = true;
+
+	Bombs.Owner = this;
+}
+
+void ALightBombManager::GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ALightBombManager, Bombs);
+}
+
+void ALightBombManager::LaunchBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InInstigatorController)
+{
+	check(Role == ROLE_Authority);
+
+	if (!BombClass)
+	{
+		return;
+	}
+
+	FLightBombEntry& Entry = Bombs.Items[Bombs.Items.AddDefaulted()];
+	Entry.BombId = NextBombId++;
+	Entry.BombClass = BombClass;
+	Entry.LaunchLocation = Location;
+	Entry.LaunchVelocity = ABomb::ComputeLaunchVelocity(BombClass, Rotation);
+	Entry.Location = Location;
+	Entry.Velocity = Entry.LaunchVelocity;
+	Entry.Instigator = InInstigator;
+	Entry.InstigatorController = InInstigatorController;
+
+	Bombs.MarkItemDirty(Entry);
+
+	// A listen server has to show the bombs to its own player as well
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		OnBombAdded(Entry);
+	}
+}
+
+void ALightBombManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Role != ROLE_Authority)
+	{
+		return;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	const bool bHasVisuals = GetNetMode() != NM_DedicatedServer;
+
+	// Walk backwards so exploded bombs can be removed on the fly
+	for (int32 Index = Bombs.Items.Num() - 1; Index >= 0; Index--)
+	{
+		FLightBombEntry& Entry = Bombs.Items[Index];
+
+		if (Entry.bIsArmed && TimeSeconds >= Entry.ExplodeTime)
+		{
+			ExplodeBomb(Entry);
+
+			if (bHasVisuals)
+			{
+				OnBombRemoved(Entry);
+			}
+
+			Bombs.Items.RemoveAtSwap(Index, 1, false);
+			Bombs.MarkArrayDirty();
+			continue;
+		}
+
+		// Same as the bomb actor: arm on the first bounce
+		if (SimulateBomb(Entry, DeltaTime) && !Entry.bIsArmed)
+		{
+			Entry.bIsArmed = true;
+			Entry.ExplodeTime = TimeSeconds + GetDefault<ABomb>(Entry.BombClass)->GetFuseTime();
+			Bombs.MarkItemDirty(Entry);
+
+			if (bHasVisuals)
+			{
+				OnBombChanged(Entry);
+			}
+		}
+	}
+}
+
+bool ALightBombManager::SimulateBomb(FLightBombEntry& Entry, float DeltaTime)
+{
+	const ABomb* DefaultBomb = GetDefault<ABomb>(Entry.BombClass);
+	const UProjectileMovementComponent* Movement = DefaultBomb->GetProjectileMovement();
+	const USphereComponent* Sphere = DefaultBomb->GetSphereComp();
+
+	Entry.Velocity.Z += GetWorld()->GetGravityZ() * Movement->ProjectileGravityScale * DeltaTime;
+	if (Movement->MaxSpeed > 0.f)
+	{
+		Entry.Velocity = Entry.Velocity.GetClampedToMaxSize(Movement->MaxSpeed);
+	}
+
+	const FVector Start = Entry.Location;
+	const FVector End = Start + Entry.Velocity * DeltaTime;
+
+	FCollisionQueryParams QueryParams(FName(TEXT("LightBombSweep")), false, Entry.Instigator.Get());
+	FCollisionResponseParams ResponseParams(Sphere->GetCollisionResponseToChannels());
+
+	FHitResult Hit;
+	if (!GetWorld()->SweepSingleByChannel(Hit, Start, End, FQuat::Identity, Sphere->GetCollisionObjectType(), FCollisionShape::MakeSphere(Sphere->GetUnscaledSphereRadius()), QueryParams, ResponseParams))
+	{
+		Entry.Location = End;
+		return false;
+	}
+
+	Entry.Location = Hit.Location;
+
+	// Bounce the same way the projectile movement component does
+	const float VDotNormal = Entry.Velocity | Hit.Normal;
+	if (VDotNormal <= 0.f)
+	{
+		const FVector ProjectedNormal = Hit.Normal * -VDotNormal;
+
+		Entry.Velocity += ProjectedNormal;
+		Entry.Velocity *= FMath::Clamp(1.f - Movement->Friction, 0.f, 1.f);
+		Entry.Velocity += ProjectedNormal * FMath::Max(Movement->Bounciness, 0.f);
+	}
+
+	if (Entry.Velocity.SizeSquared() < FMath::Square(Movement->BounceVelocityStopSimulatingThreshold))
+	{
+		Entry.Velocity = FVector::ZeroVector;
+	}
+
+	return true;
+}
+
+void ALightBombManager::ExplodeBomb(const FLightBombEntry& Entry)
+{
+	const ABomb* DefaultBomb = GetDefault<ABomb>(Entry.BombClass);
+
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (AExplosionManager* ExplosionManager = GameMode ? GameMode->GetExplosionManager() : nullptr)
+	{
+		ExplosionManager->AddExplosion(Entry.Location, DefaultBomb->GetExplosionRadius(), DefaultBomb->GetExplosionDamage(), this, Entry.InstigatorController.Get());
+		return;
+	}
+
+	// Do not ignore any actors
+	TArray<AActor*> IgnoreActors;
+
+	UGameplayStatics::ApplyRadialDamage(GetWorld(), DefaultBomb->GetExplosionDamage(), Entry.Location, DefaultBomb->GetExplosionRadius(), UDamageType::StaticClass(), IgnoreActors, this, Entry.InstigatorController.Get());
+}
+
+// ---------------- Client visuals
+// -----------------------------
+
+void ALightBombManager::OnBombAdded(FLightBombEntry& Entry)
+{
+	if (!Entry.BombClass)
+	{
+		return;
+	}
+
+	const FTransform SpawnTransform(FVector(Entry.LaunchVelocity).Rotation(), Entry.LaunchLocation);
+
+	// The proxy is a plain local bomb that never replicates nor deals damage
+	ABomb* Proxy = GetWorld()->SpawnActorDeferred<ABomb>(Entry.BombClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Proxy)
+	{
+		return;
+	}
+
+	Proxy->SetReplicates(false);
+	Proxy->SetCosmeticProxy();
+	UGameplayStatics::FinishSpawningActor(Proxy, SpawnTransform);
+
+	Proxy->LaunchCosmeticProxy(Entry.LaunchVelocity);
+	Entry.Proxy = Proxy;
+
+	if (Entry.bIsArmed)
+	{
+		Proxy->ArmCosmeticProxy();
+	}
+}
+
+void ALightBombManager::OnBombChanged(FLightBombEntry& Entry)
+{
+	if (Entry.bIsArmed && Entry.Proxy.IsValid())
+	{
+		Entry.Proxy->ArmCosmeticProxy();
+	}
+}
+
+void ALightBombManager::OnBombRemoved(FLightBombEntry& Entry)
+{
+	// Bombs only leave the array when they explode
+	if (ABomb* Proxy = Entry.Proxy.Get())
+	{
+		Proxy->PlayExplosionFX();
+		Proxy->Destroy();
+	}
+}
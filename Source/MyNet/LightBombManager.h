@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "Bomb.h"
+#include "LightBombManager.generated.h"
+
+class ALightBombManager;
+struct FLightBombArray;
+
+/** A single bomb simulated by the light bomb manager */
+USTRUCT()
+struct FLightBombEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Id of the bomb, unique among the live bombs */
+	UPROPERTY()
+	uint16 BombId = 0;
+
+	/** The class the bomb properties are read from */
+	UPROPERTY()
+	TSubclassOf<ABomb> BombClass;
+
+	UPROPERTY()
+	FVector_NetQuantize LaunchLocation;
+
+	UPROPERTY()
+	FVector_NetQuantize10 LaunchVelocity;
+
+	UPROPERTY()
+	bool bIsArmed = false;
+
+	/** Server world time the bomb explodes at. Only valid once armed */
+	UPROPERTY()
+	float ExplodeTime = 0.f;
+
+	// Server side simulation state
+
+	UPROPERTY(NotReplicated)
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(NotReplicated)
+	FVector Velocity = FVector::ZeroVector;
+
+	TWeakObjectPtr<APawn> Instigator;
+
+	TWeakObjectPtr<AController> InstigatorController;
+
+	// Client side visuals
+
+	TWeakObjectPtr<ABomb> Proxy;
+
+	void PostReplicatedAdd(const FLightBombArray& InArraySerializer);
+	void PostReplicatedChange(const FLightBombArray& InArraySerializer);
+	void PreReplicatedRemove(const FLightBombArray& InArraySerializer);
+};
+
+/** Delta serialized list of the live bombs */
+USTRUCT()
+struct FLightBombArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FLightBombEntry> Items;
+
+	/** The manager that owns the array */
+	UPROPERTY(NotReplicated)
+	ALightBombManager* Owner = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FLightBombArray> : public TStructOpsTypeTraitsBase2<FLightBombArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+* Lightweight alternative to replicating one ABomb actor per throw.
+* The server simulates all the live bombs here and replicates them as a single
+* delta serialized array of launch parameters. Clients only spawn local visual proxies.
+*/
+UCLASS(notplaceable)
+class MYNET_API ALightBombManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ALightBombManager();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Marks the properties we wish to replicate */
+	virtual void GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const override;
+
+	/** Launches a bomb of the given class. Server only */
+	void LaunchBomb(TSubclassOf<ABomb> BombClass, const FVector& Location, const FRotator& Rotation, APawn* InInstigator, AController* InInstigatorController);
+
+	/** Returns the number of bombs in play */
+	int32 GetNumBombs() const { return Bombs.Items.Num(); }
+
+	// Client notifications, called by the replicated entries
+
+	void OnBombAdded(FLightBombEntry& Entry);
+	void OnBombChanged(FLightBombEntry& Entry);
+	void OnBombRemoved(FLightBombEntry& Entry);
+
+private:
+	/** Moves a bomb for one frame, returns true if it hit something */
+	bool SimulateBomb(FLightBombEntry& Entry, float DeltaTime);
+
+	/** Applies the damage of an exploded bomb */
+	void ExplodeBomb(const FLightBombEntry& Entry);
+
+	/** All the live bombs */
+	UPROPERTY(Replicated)
+	FLightBombArray Bombs;
+
+	/** Id handed to the next launched bomb */
+	uint16 NextBombId = 0;
+};
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LoadTestRecorder.h"
+#include "MyNet.h"
+#include "MyNetPlayerController.h"
+#include "MyNetGameMode.h"
+#include "MatchManager.h"
+#include "ServerTickManager.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+#include "HAL/PlatformFilemanager.h"
+
+bool ALoadTestRecorder::bRecording = false;
+uint32 ALoadTestRecorder::ScopeCycles[(int32)ELoadTestScope::Num] = {};
+
+/** The players get this long to join before the run starts anyway */
+static const float MaxWaitForPlayers = 60.f;
+
+FLoadTestScope::FLoadTestScope(ELoadTestScope InScope)
+	: Scope(InScope)
+	, StartCycles(ALoadTestRecorder::IsRecording() ? FPlatformTime::Cycles() : 0)
+{
+}
+
+FLoadTestScope::~FLoadTestScope()
+{
+	if (StartCycles != 0)
+	{
+		ALoadTestRecorder::AddScopeCycles(Scope, FPlatformTime::Cycles() - StartCycles);
+	}
+}
+
+/** Average of some samples */
+static float GetAverage(const TArray<float>& Samples)
+{
+	float Sum = 0.f;
+	for (float Sample : Samples)
+	{
+		Sum += Sample;
+	}
+	return Samples.Num() > 0 ? Sum / Samples.Num() : 0.f;
+}
+
+/** Value below which Percentile of the samples are */
+static float GetPercentile(TArray<float> Samples, float Percentile)
+{
+	if (Samples.Num() == 0)
+	{
+		return 0.f;
+	}
+
+	Samples.Sort();
+	return Samples[FMath::Clamp(FMath::FloorToInt(Samples.Num() * Percentile), 0, Samples.Num() - 1)];
+}
+
+ALoadTestRecorder::ALoadTestRecorder()
+{
+	// Last, so the ticks of the characters and bombs of this frame are counted
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_LastDemotable;
+
+	// Server only
+	SetReplicates(false);
+}
+
+void ALoadTestRecorder::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("LoadTestPlayers="), ExpectedPlayers);
+	FParse::Value(CommandLine, TEXT("LoadTestDuration="), Duration);
+
+	if (!FParse::Value(CommandLine, TEXT("LoadTestCsv="), CsvPath))
+	{
+		CsvPath = FPaths::GameSavedDir() / TEXT("LoadTest") / TEXT("LoadTest.csv");
+	}
+
+	if (!FParse::Value(CommandLine, TEXT("LoadTestLabel="), Label))
+	{
+		Label = FApp::GetBuildVersion();
+	}
+
+	UE_LOG(LogMyNet, Log, TEXT("Load test: waiting for %d players, then recording %.0f seconds to %s"), ExpectedPlayers, Duration, *CsvPath);
+}
+
+void ALoadTestRecorder::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	bRecording = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ALoadTestRecorder::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	ElapsedTime += DeltaTime;
+
+	if (!bRecording)
+	{
+		AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+		const int32 NumPlayers = GameMode ? GameMode->GetNumPlayers() : 0;
+
+		if (NumPlayers >= ExpectedPlayers || ElapsedTime >= MaxWaitForPlayers)
+		{
+			UE_LOG(LogMyNet, Log, TEXT("Load test: recording with %d players"), NumPlayers);
+
+			bRecording = true;
+			ElapsedTime = 0.f;
+			NextConnectionSample = 1.f;
+			FMemory::Memzero(ScopeCycles);
+		}
+		return;
+	}
+
+	FrameTimes.Add(DeltaTime * 1000.f);
+	GameThreadTimes.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+
+	for (int32 Index = 0; Index < (int32)ELoadTestScope::Num; Index++)
+	{
+		ScopeTimes[Index].Add(FPlatformTime::ToMilliseconds(ScopeCycles[Index]));
+		ScopeCycles[Index] = 0;
+	}
+
+	// The connections count their bytes per second
+	if (ElapsedTime >= NextConnectionSample)
+	{
+		SampleConnections();
+		NextConnectionSample += 1.f;
+	}
+
+	if (ElapsedTime >= Duration)
+	{
+		Finish();
+	}
+}
+
+void ALoadTestRecorder::SampleConnections()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver)
+	{
+		return;
+	}
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection)
+		{
+			InBytesSum += Connection->InBytesPerSecond;
+			OutBytesSum += Connection->OutBytesPerSecond;
+			NumConnectionSamples++;
+		}
+	}
+}
+
+void ALoadTestRecorder::Finish()
+{
+	bRecording = false;
+	bFinished = true;
+
+	int32 NumPlayers = 0;
+	int32 RpcCounts[3] = {};
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		NumPlayers++;
+
+		if (const AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(It->Get()))
+		{
+			for (int32 Index = 0; Index < (int32)ERpcBudget::Num; Index++)
+			{
+				const FRpcTokenBucket& Bucket = PlayerController->GetRpcBucket((ERpcBudget)Index);
+				RpcCounts[0] += Bucket.NumAccepted;
+				RpcCounts[1] += Bucket.NumRejected;
+				RpcCounts[2] += Bucket.NumCoalesced;
+			}
+		}
+	}
+
+	const double InBytes = NumConnectionSamples > 0 ? InBytesSum / NumConnectionSamples : 0.0;
+	const double OutBytes = NumConnectionSamples > 0 ? OutBytesSum / NumConnectionSamples : 0.0;
+
+	const FString Row = FString::Printf(TEXT("%s,%d,%.1f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%.0f,%d,%d,%d\n"),
+		*Label, NumPlayers, ElapsedTime, FrameTimes.Num(),
+		GetAverage(FrameTimes), GetPercentile(FrameTimes, 0.95f), GetPercentile(FrameTimes, 1.f),
+		GetAverage(GameThreadTimes),
+		GetAverage(ScopeTimes[(int32)ELoadTestScope::Character]), GetAverage(ScopeTimes[(int32)ELoadTestScope::Bomb]),
+		InBytes, OutBytes,
+		RpcCounts[0], RpcCounts[1], RpcCounts[2]);
+
+	// A new file gets the header first, runs of other builds are appended below
+	if (!FPlatformFileManager::Get().GetPlatformFile().FileExists(*CsvPath))
+	{
+		FFileHelper::SaveStringToFile(TEXT("Label,Players,Seconds,Frames,AvgFrameMs,P95FrameMs,MaxFrameMs,AvgGameThreadMs,AvgCharacterMs,AvgBombMs,InBytesPerSecPerConnection,OutBytesPerSecPerConnection,RpcAccepted,RpcRejected,RpcCoalesced\n"), *CsvPath);
+	}
+	FFileHelper::SaveStringToFile(Row, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	UE_LOG(LogMyNet, Log, TEXT("Load test: done, %s"), *Row);
+
+	// The split over the matches, when the server hosts several
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	AMatchManager* MatchManager = GameMode ? GameMode->GetMatchManager() : nullptr;
+	if (MatchManager && MatchManager->IsEnabled())
+	{
+		MatchManager->LogReport();
+	}
+
+	// The steps, when the server ran in fixed steps
+	if (AServerTickManager* ServerTickManager = GameMode ? GameMode->GetServerTickManager() : nullptr)
+	{
+		ServerTickManager->LogReport();
+	}
+
+	if (IsRunningDedicatedServer())
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "LoadTestRecorder.generated.h"
+
+/** The game thread time a load test run splits out */
+enum class ELoadTestScope : uint8
+{
+	Character,
+	Bomb,
+
+	Num
+};
+
+/**
+* Adds the time spent in its scope to the current frame of the load test, if one is recording.
+* Costs a branch otherwise.
+*/
+struct MYNET_API FLoadTestScope
+{
+	explicit FLoadTestScope(ELoadTestScope InScope);
+	~FLoadTestScope();
+
+private:
+	ELoadTestScope Scope;
+	uint32 StartCycles;
+};
+
+/**
+* Records the server side of a bot load test and writes a one line CSV summary of it.
+* Spawned by the game mode when the server runs with -LoadTest, see UBotLoadTestCommandlet.
+*
+* Waits for -LoadTestPlayers players (or a minute), then records -LoadTestDuration seconds of:
+* frame and game thread time, the time spent in the character and bomb code, the bytes in and out of
+* every connection and the server RPC counters. The summary is appended to -LoadTestCsv,
+* and a dedicated server exits once it is written.
+*/
+UCLASS(notplaceable)
+class MYNET_API ALoadTestRecorder : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ALoadTestRecorder();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** True while a run is being recorded */
+	static bool IsRecording() { return bRecording; }
+
+	/** Called by FLoadTestScope */
+	static void AddScopeCycles(ELoadTestScope Scope, uint32 Cycles) { ScopeCycles[(int32)Scope] += Cycles; }
+
+private:
+	/** Samples the bytes per second of the client connections */
+	void SampleConnections();
+
+	/** Writes the summary and ends the run */
+	void Finish();
+
+	/** Settings from the command line */
+	int32 ExpectedPlayers = 1;
+	float Duration = 60.f;
+	FString CsvPath;
+	FString Label;
+
+	/** Seconds spent waiting for the players, then recording */
+	float ElapsedTime = 0.f;
+	float NextConnectionSample = 0.f;
+	bool bFinished = false;
+
+	/** Per frame samples, in ms */
+	TArray<float> FrameTimes;
+	TArray<float> GameThreadTimes;
+	TArray<float> ScopeTimes[(int32)ELoadTestScope::Num];
+
+	/** Sums of the per second connection samples */
+	double InBytesSum = 0.0;
+	double OutBytesSum = 0.0;
+	int32 NumConnectionSamples = 0;
+
+	static bool bRecording;
+	static uint32 ScopeCycles[(int32)ELoadTestScope::Num];
+};
@@ -0,0 +1,397 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchEventLog.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Containers/Queue.h"
+
+/** Returns the id a log knows an actor by */
+static uint32 GetEventId(const UObject* Object)
+{
+	return Object ? Object->GetUniqueID() : 0;
+}
+
+/**
+* Appends the buffers of the recorder to the log file on its own thread.
+* The buffers go back to the recorder once written, so none get allocated after the first few.
+*/
+class FMatchEventWriter : public FRunnable
+{
+public:
+	explicit FMatchEventWriter(IFileHandle* InFile)
+		: File(InFile)
+		, WorkEvent(FPlatformProcess::GetSynchEventFromPool())
+	{
+		Thread = FRunnableThread::Create(this, TEXT("MatchEventWriter"), 0, TPri_BelowNormal);
+	}
+
+	/** Writes what is left, then closes the file */
+	virtual ~FMatchEventWriter()
+	{
+		if (Thread)
+		{
+			Thread->Kill(true);
+			delete Thread;
+		}
+
+		// Without a thread everything is still queued
+		WritePending();
+
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		delete File;
+	}
+
+	/** Queues a full buffer. Game thread */
+	void Submit(TArray<uint8>&& Buffer)
+	{
+		Pending.Enqueue(MoveTemp(Buffer));
+		WorkEvent->Trigger();
+	}
+
+	/** Returns a written buffer to fill again, or an empty one. Game thread */
+	void TakeFreeBuffer(TArray<uint8>& OutBuffer)
+	{
+		if (!Free.Dequeue(OutBuffer))
+		{
+			OutBuffer.Reset();
+		}
+	}
+
+	virtual uint32 Run() override
+	{
+		while (!bStopping)
+		{
+			WorkEvent->Wait(100);
+			WritePending();
+		}
+
+		WritePending();
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		bStopping = true;
+		WorkEvent->Trigger();
+	}
+
+private:
+	void WritePending()
+	{
+		TArray<uint8> Buffer;
+		bool bWrote = false;
+
+		while (Pending.Dequeue(Buffer))
+		{
+			File->Write(Buffer.GetData(), Buffer.Num());
+			Buffer.Reset();
+			Free.Enqueue(MoveTemp(Buffer));
+			bWrote = true;
+		}
+
+		if (bWrote)
+		{
+			File->Flush();
+		}
+	}
+
+	IFileHandle* File;
+	FEvent* WorkEvent;
+	FRunnableThread* Thread = nullptr;
+	FThreadSafeBool bStopping;
+
+	/** Filled buffers, from the game thread */
+	TQueue<TArray<uint8>, EQueueMode::Spsc> Pending;
+
+	/** Written buffers, back to the game thread */
+	TQueue<TArray<uint8>, EQueueMode::Spsc> Free;
+};
+
+// ---------------- Recorder
+// -----------------------------
+
+AMatchEventRecorder::AMatchEventRecorder()
+{
+	// First, so the positions are where the characters ended the previous frame, where its explosions were resolved
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	// Server only
+	SetReplicates(false);
+}
+
+bool AMatchEventRecorder::IsRequested()
+{
+	// The commandlets replay and benchmark in worlds of their own, recording those would only add logs of the replays
+	if (IsRunningCommandlet())
+	{
+		return false;
+	}
+
+	FString Path;
+	return GetDefault<AMatchEventRecorder>()->bRecordEvents || FParse::Param(FCommandLine::Get(), TEXT("EventLog")) || FParse::Value(FCommandLine::Get(), TEXT("EventLog="), Path);
+}
+
+void AMatchEventRecorder::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FString Path;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("EventLog="), Path))
+	{
+		Path = FPaths::GameSavedDir() / TEXT("EventLogs") / FString::Printf(TEXT("%s.mnlog"), *FDateTime::Now().ToString());
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+
+	// Appended to, a log may hold several sessions
+	IFileHandle* File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path, true);
+	if (!File)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Match event log: couldn't open %s"), *Path);
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	FlushBytes = FMath::Max(FlushBytes, 1024);
+	Buffer.Reserve(FlushBytes + 1024);
+	Writer = new FMatchEventWriter(File);
+
+	BeginRecord(EMatchEvent::Session);
+	Write(uint32(Magic));
+	Write(uint16(Version));
+
+	UE_LOG(LogMyNet, Log, TEXT("Match event log: recording to %s"), *Path);
+}
+
+void AMatchEventRecorder::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Writer)
+	{
+		Submit(true);
+
+		// Waits for the writes
+		delete Writer;
+		Writer = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMatchEventRecorder::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!Writer)
+	{
+		return;
+	}
+
+	TimeSincePositions += DeltaTime;
+	if (TimeSincePositions >= PositionInterval)
+	{
+		TimeSincePositions = 0.f;
+
+		BeginRecord(EMatchEvent::Positions);
+
+		// The count is patched in once known
+		const int32 CountOffset = Buffer.Num();
+		Write(uint16(0));
+
+		uint16 Count = 0;
+		for (TActorIterator<AMyNetCharacter> It(GetWorld()); It && Count < MAX_uint16; ++It)
+		{
+			Write(GetEventId(*It));
+			Write(It->GetActorLocation());
+			Count++;
+		}
+
+		FMemory::Memcpy(Buffer.GetData() + CountOffset, &Count, sizeof(Count));
+	}
+
+	Submit(false);
+
+	const int64 RecordedBytes = SubmittedBytes + Buffer.Num();
+	INC_DWORD_STAT_BY(STAT_MyNet_EventLogBytes, (uint32)(RecordedBytes - LastRecordedBytes));
+	LastRecordedBytes = RecordedBytes;
+}
+
+void AMatchEventRecorder::BeginRecord(EMatchEvent Type)
+{
+	Write(Type);
+	Write(GetWorld()->GetTimeSeconds());
+}
+
+void AMatchEventRecorder::Submit(bool bForce)
+{
+	if (Buffer.Num() == 0 || (!bForce && Buffer.Num() < FlushBytes))
+	{
+		return;
+	}
+
+	SubmittedBytes += Buffer.Num();
+
+	Writer->Submit(MoveTemp(Buffer));
+	Writer->TakeFreeBuffer(Buffer);
+}
+
+void AMatchEventRecorder::RecordBombSpawn(const AActor* Bomb, const AActor* Thrower, const FVector& Location, const FVector& Velocity)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	BeginRecord(EMatchEvent::BombSpawn);
+	Write(GetEventId(Bomb));
+	Write(GetEventId(Thrower));
+	Write(Location);
+	Write(Velocity);
+}
+
+void AMatchEventRecorder::RecordBounce(const AActor* Bomb, const FVector& Velocity, bool bArmed)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	BeginRecord(EMatchEvent::Bounce);
+	Write(GetEventId(Bomb));
+	Write(Bomb->GetActorLocation());
+	Write(Velocity);
+	Write(uint8(bArmed));
+}
+
+void AMatchEventRecorder::RecordExplosion(const FVector& Origin, float Radius, float Damage, const AActor* DamageCauser, const AController* EventInstigator)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	BeginRecord(EMatchEvent::Explosion);
+	Write(GetEventId(DamageCauser));
+	Write(GetEventId(EventInstigator ? EventInstigator->GetPawn() : nullptr));
+	Write(Origin);
+	Write(Radius);
+	Write(Damage);
+}
+
+void AMatchEventRecorder::RecordDamage(const AActor* Victim, float Damage, const AController* EventInstigator)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	BeginRecord(EMatchEvent::Damage);
+	Write(GetEventId(Victim));
+	Write(GetEventId(EventInstigator ? EventInstigator->GetPawn() : nullptr));
+	Write(Damage);
+}
+
+// ---------------- Reader
+// -----------------------------
+
+bool FMatchEventReader::Open(const FString& Path)
+{
+	Offset = 0;
+	if (!FFileHelper::LoadFileToArray(Data, *Path))
+	{
+		return false;
+	}
+
+	// Peek at the first record
+	FMatchEvent Event;
+	const bool bValid = Next(Event) && Event.Type == EMatchEvent::Session;
+	Offset = 0;
+	return bValid;
+}
+
+bool FMatchEventReader::Read(void* Dest, int32 Size)
+{
+	if (Offset + Size > Data.Num())
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(Dest, Data.GetData() + Offset, Size);
+	Offset += Size;
+	return true;
+}
+
+bool FMatchEventReader::Next(FMatchEvent& OutEvent)
+{
+	if (!Read(&OutEvent.Type, sizeof(OutEvent.Type)) || !Read(&OutEvent.Time, sizeof(OutEvent.Time)))
+	{
+		return false;
+	}
+
+	switch (OutEvent.Type)
+	{
+	case EMatchEvent::Session:
+	{
+		uint32 Magic = 0;
+		uint16 Version = 0;
+		return Read(&Magic, sizeof(Magic)) && Read(&Version, sizeof(Version)) && Magic == AMatchEventRecorder::Magic && Version == AMatchEventRecorder::Version;
+	}
+
+	case EMatchEvent::BombSpawn:
+		return Read(&OutEvent.ActorId, sizeof(uint32)) && Read(&OutEvent.InstigatorId, sizeof(uint32))
+			&& Read(&OutEvent.Location, sizeof(FVector)) && Read(&OutEvent.Velocity, sizeof(FVector));
+
+	case EMatchEvent::Bounce:
+	{
+		uint8 bArmed = 0;
+		const bool bRead = Read(&OutEvent.ActorId, sizeof(uint32)) && Read(&OutEvent.Location, sizeof(FVector))
+			&& Read(&OutEvent.Velocity, sizeof(FVector)) && Read(&bArmed, sizeof(bArmed));
+		OutEvent.bArmed = bArmed != 0;
+		return bRead;
+	}
+
+	case EMatchEvent::Explosion:
+		return Read(&OutEvent.ActorId, sizeof(uint32)) && Read(&OutEvent.InstigatorId, sizeof(uint32))
+			&& Read(&OutEvent.Location, sizeof(FVector)) && Read(&OutEvent.Radius, sizeof(float)) && Read(&OutEvent.Damage, sizeof(float));
+
+	case EMatchEvent::Damage:
+		return Read(&OutEvent.ActorId, sizeof(uint32)) && Read(&OutEvent.InstigatorId, sizeof(uint32)) && Read(&OutEvent.Damage, sizeof(float));
+
+	case EMatchEvent::Positions:
+	{
+		uint16 Count = 0;
+		if (!Read(&Count, sizeof(Count)))
+		{
+			return false;
+		}
+
+		OutEvent.Positions.Reset(Count);
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			uint32 CharacterId = 0;
+			FVector Location;
+			if (!Read(&CharacterId, sizeof(CharacterId)) || !Read(&Location, sizeof(Location)))
+			{
+				return false;
+			}
+			OutEvent.Positions.Emplace(CharacterId, Location);
+		}
+		return true;
+	}
+
+	default:
+		// Unknown record, the rest can't be decoded
+		return false;
+	}
+}
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "MatchEventLog.generated.h"
+
+/** The records of a match event log */
+enum class EMatchEvent : uint8
+{
+	/** Starts the records of a server run: magic and version */
+	Session,
+
+	/** A bomb left the hand of a character */
+	BombSpawn,
+
+	/** A bomb bounced, arming it the first time */
+	Bounce,
+
+	/** An explosion handed to the explosion manager */
+	Explosion,
+
+	/** Damage applied to a character */
+	Damage,
+
+	/** The location of every character at the start of a frame */
+	Positions,
+
+	Num
+};
+
+/**
+* One decoded record. Only the fields of its type are set.
+* Actors are identified by their UObject unique id, 0 for none.
+*/
+struct FMatchEvent
+{
+	EMatchEvent Type = EMatchEvent::Num;
+
+	/** World time of the server */
+	float Time = 0.f;
+
+	/** The bomb, the damage causer or the victim */
+	uint32 ActorId = 0;
+
+	/** The character that threw the bomb or dealt the damage */
+	uint32 InstigatorId = 0;
+
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	float Radius = 0.f;
+	float Damage = 0.f;
+	bool bArmed = false;
+
+	/** Ids and locations of the characters, for Positions */
+	TArray<TPair<uint32, FVector>> Positions;
+};
+
+/**
+* Reads a match event log written by AMatchEventRecorder, one record after the other.
+* Every record is its uint8 type and float time followed by its fields, packed, in the byte order of the server:
+*	Session		uint32 magic, uint16 version
+*	BombSpawn	uint32 bomb, uint32 thrower, FVector location, FVector velocity
+*	Bounce		uint32 bomb, FVector location, FVector velocity, uint8 armed
+*	Explosion	uint32 causer, uint32 instigator, FVector origin, float radius, float damage
+*	Damage		uint32 victim, uint32 instigator, float damage
+*	Positions	uint16 count, then count times uint32 character, FVector location
+*/
+struct MYNET_API FMatchEventReader
+{
+	/** Loads the whole log, returns false if it can't be read or doesn't start with a session */
+	bool Open(const FString& Path);
+
+	/** Decodes the next record, returns false at the end or on a truncated record */
+	bool Next(FMatchEvent& OutEvent);
+
+private:
+	bool Read(void* Dest, int32 Size);
+
+	TArray<uint8> Data;
+	int32 Offset = 0;
+};
+
+/**
+* Records the gameplay of the server to a compact binary log: bomb spawns, bounces, explosions, damage
+* and the location of every character each frame, see FMatchEventReader for the format.
+* Records are appended to a buffer on the game thread, full buffers are written to the end of the file
+* by a background thread and come back empty. Replay a log with UReplayEventLogCommandlet.
+* Spawned by the game mode when bRecordEvents is set or the server runs with -EventLog[=Path], except in commandlets.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AMatchEventRecorder : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AMatchEventRecorder();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns true if the server should record. Never in a commandlet */
+	static bool IsRequested();
+
+	void RecordBombSpawn(const AActor* Bomb, const AActor* Thrower, const FVector& Location, const FVector& Velocity);
+
+	void RecordBounce(const AActor* Bomb, const FVector& Velocity, bool bArmed);
+
+	void RecordExplosion(const FVector& Origin, float Radius, float Damage, const AActor* DamageCauser, const AController* EventInstigator);
+
+	void RecordDamage(const AActor* Victim, float Damage, const AController* EventInstigator);
+
+	/** Version of the records, bumped whenever their layout changes */
+	static const uint16 Version = 1;
+
+	/** Starts every session, spells MNEL */
+	static const uint32 Magic = 0x4C454E4D;
+
+protected:
+	/** Records every match the server runs, same as -EventLog */
+	UPROPERTY(Config, EditAnywhere, Category = EventLog)
+	bool bRecordEvents = false;
+
+	/** Seconds between two Positions records, 0 for every frame */
+	UPROPERTY(Config, EditAnywhere, Category = EventLog)
+	float PositionInterval = 0.f;
+
+	/** Size of a buffer handed to the writer thread */
+	UPROPERTY(Config, EditAnywhere, Category = EventLog)
+	int32 FlushBytes = 64 * 1024;
+
+private:
+	/** Starts a record of the current time */
+	void BeginRecord(EMatchEvent Type);
+
+	template<typename T>
+	void Write(const T& Value)
+	{
+		const int32 Offset = Buffer.AddUninitialized(sizeof(T));
+		FMemory::Memcpy(Buffer.GetData() + Offset, &Value, sizeof(T));
+	}
+
+	/** Hands the buffer to the writer thread once it's full, or whatever it holds if bForce */
+	void Submit(bool bForce);
+
+	/** The records not handed over yet */
+	TArray<uint8> Buffer;
+
+	/** Writes to the file off the game thread */
+	class FMatchEventWriter* Writer = nullptr;
+
+	float TimeSincePositions = 0.f;
+
+	/** Bytes handed to the writer so far, and recorded up to the last frame, for the stat */
+	int64 SubmittedBytes = 0;
+	int64 LastRecordedBytes = 0;
+};
@@ -0,0 +1,374 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchManager.h"
+#include "MyNet.h"
+#include "MyNetGameMode.h"
+#include "MyNetPlayerController.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LevelStreamingKismet.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/PackageName.h"
+
+bool AMatchManager::bAccounting = false;
+uint32 AMatchManager::MatchCycles[MaxMatchInstances] = {};
+
+FMatchCostScope::FMatchCostScope(int32 InMatchId)
+	: MatchId(InMatchId)
+	, StartCycles(AMatchManager::IsAccounting() && InMatchId >= 0 && InMatchId < MaxMatchInstances ? FPlatformTime::Cycles() : 0)
+{
+}
+
+FMatchCostScope::~FMatchCostScope()
+{
+	if (StartCycles != 0)
+	{
+		AMatchManager::AddMatchCycles(MatchId, FPlatformTime::Cycles() - StartCycles);
+	}
+}
+
+AMatchManager::AMatchManager()
+{
+	// Last, so the ticks of the characters of this frame are counted
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_LastDemotable;
+
+	// Server only
+	SetReplicates(false);
+
+	ArenaMap = TEXT("/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap");
+}
+
+void AMatchManager::Init()
+{
+	// Set by UBotLoadTestCommandlet
+	const TCHAR* CommandLine = FCommandLine::Get();
+	int32 NumMatches = 0;
+	if (FParse::Value(CommandLine, TEXT("Matches="), NumMatches))
+	{
+		bMultiMatch = NumMatches > 1;
+		MaxMatches = NumMatches;
+	}
+	FParse::Value(CommandLine, TEXT("MatchPlayers="), MaxPlayersPerMatch);
+
+	ArenaSpacing = FMath::Max(ArenaSpacing, 1.f);
+	if (MaxMatches > GetMaxArenas())
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Match manager: only %d arenas %.0f apart fit in the world"), GetMaxArenas(), ArenaSpacing);
+	}
+
+	MaxMatches = FMath::Clamp(MaxMatches, 1, FMath::Min(MaxMatchInstances, GetMaxArenas()));
+	MaxPlayersPerMatch = FMath::Max(MaxPlayersPerMatch, 1);
+
+	SetActorTickEnabled(bMultiMatch);
+	if (!bMultiMatch)
+	{
+		return;
+	}
+
+	// The first match plays in the persistent level
+	BaselineMemory = FPlatformMemory::GetStats().UsedPhysical;
+	CreateMatch();
+
+	bAccounting = true;
+	FMemory::Memzero(MatchCycles);
+	NextConnectionSample = 1.f;
+
+	UE_LOG(LogMyNet, Log, TEXT("Match manager: up to %d matches of %d players, arenas %.0f apart"), MaxMatches, MaxPlayersPerMatch, ArenaSpacing);
+}
+
+void AMatchManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	bAccounting = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 AMatchManager::CreateMatch()
+{
+	const int32 MatchId = Matches.AddDefaulted();
+	FMatchInstance& Match = Matches[MatchId];
+	Match.Origin = GetArenaOrigin(MatchId);
+
+	if (MatchId == 0)
+	{
+		Match.bReady = true;
+		return MatchId;
+	}
+
+	Match.MemoryBeforeArena = FPlatformMemory::GetStats().UsedPhysical;
+
+	Match.ArenaLevel = LoadArena(GetWorld(), ArenaMap, MatchId, Match.Origin);
+	if (!Match.ArenaLevel)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Match manager: couldn't stream in the arena %s for match %d"), *ArenaMap, MatchId);
+	}
+
+	return MatchId;
+}
+
+ULevelStreamingKismet* AMatchManager::LoadArena(UWorld* World, const FString& ArenaMap, int32 MatchId, const FVector& Origin)
+{
+	FString LongPackageName;
+	if (!World || !FPackageName::SearchForPackageOnDisk(ArenaMap, &LongPackageName))
+	{
+		return nullptr;
+	}
+
+	// What LoadLevelInstance does, but its names count the instances of the process and a client only loads its own arena
+	const FString ArenaPackageName = FString::Printf(TEXT("%s/%s%s_Match_%d"), *FPackageName::GetLongPackagePath(LongPackageName),
+		*World->StreamingLevelsPrefix, *FPackageName::GetShortName(LongPackageName), MatchId);
+
+	ULevelStreamingKismet* ArenaLevel = NewObject<ULevelStreamingKismet>(World, NAME_None, RF_Transient);
+	ArenaLevel->SetWorldAssetByPackageName(FName(*ArenaPackageName));
+	ArenaLevel->PackageNameToLoad = FName(*LongPackageName);
+	ArenaLevel->LevelTransform = FTransform(Origin);
+	ArenaLevel->bShouldBeLoaded = true;
+	ArenaLevel->bShouldBeVisible = true;
+	ArenaLevel->bShouldBlockOnLoad = false;
+	ArenaLevel->bInitiallyLoaded = true;
+	ArenaLevel->bInitiallyVisible = true;
+
+	World->StreamingLevels.Add(ArenaLevel);
+
+	return ArenaLevel;
+}
+
+FVector AMatchManager::GetArenaOrigin(int32 MatchId) const
+{
+	if (MatchId <= 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// Ring R holds the 8R cells after the (2R - 1)^2 of the rings inside it
+	int32 Ring = 1;
+	while ((2 * Ring + 1) * (2 * Ring + 1) <= MatchId)
+	{
+		Ring++;
+	}
+
+	const int32 Position = MatchId - (2 * Ring - 1) * (2 * Ring - 1);
+	const int32 Side = Position / (2 * Ring);
+	const int32 Offset = Position % (2 * Ring);
+
+	// Around the ring from its corner at -Ring, -Ring
+	int32 X = 0;
+	int32 Y = 0;
+	switch (Side)
+	{
+	case 0:		X = -Ring + Offset;	Y = -Ring;			break;
+	case 1:		X = Ring;			Y = -Ring + Offset;	break;
+	case 2:		X = Ring - Offset;	Y = Ring;			break;
+	default:	X = -Ring;			Y = Ring - Offset;	break;
+	}
+
+	return FVector(ArenaSpacing * X, ArenaSpacing * Y, 0.f);
+}
+
+int32 AMatchManager::GetMaxArenas() const
+{
+	// The arena reaches half a cell past its origin
+	const int32 Rings = FMath::Max(FMath::FloorToInt((HALF_WORLD_MAX - ArenaSpacing * 0.5f) / ArenaSpacing), 0);
+	return (2 * Rings + 1) * (2 * Rings + 1);
+}
+
+int32 AMatchManager::AddPlayer(APlayerController* Player)
+{
+	AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(Player);
+	if (!bMultiMatch || !PlayerController)
+	{
+		return 0;
+	}
+
+	// Fill the matches one after the other
+	int32 MatchId = Matches.IndexOfByPredicate([this](const FMatchInstance& Match) { return Match.Players.Num() < MaxPlayersPerMatch; });
+	if (MatchId == INDEX_NONE)
+	{
+		if (Matches.Num() >= MaxMatches)
+		{
+			// Let in by PreLogin together with others that took the last seats
+			PlayerController->SetMatchId(INDEX_NONE);
+			return INDEX_NONE;
+		}
+
+		MatchId = CreateMatch();
+	}
+
+	FMatchInstance& Match = Matches[MatchId];
+	Match.Players.Add(PlayerController);
+
+	PlayerController->SetMatchId(MatchId);
+	PlayerController->ClientEnterMatch(MatchId, Match.Origin);
+
+	return MatchId;
+}
+
+void AMatchManager::RemovePlayer(AController* Player)
+{
+	AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(Player);
+	if (PlayerController && Matches.IsValidIndex(PlayerController->GetMatchId()))
+	{
+		Matches[PlayerController->GetMatchId()].Players.RemoveSingleSwap(PlayerController);
+	}
+}
+
+bool AMatchManager::IsFull() const
+{
+	return bMultiMatch && Matches.Num() >= MaxMatches && !Matches.ContainsByPredicate([this](const FMatchInstance& Match) { return Match.Players.Num() < MaxPlayersPerMatch; });
+}
+
+bool AMatchManager::IsMatchReady(const APlayerController* Player) const
+{
+	const AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(Player);
+	if (!bMultiMatch || !PlayerController)
+	{
+		return true;
+	}
+
+	// Players without a match never get a pawn
+	return Matches.IsValidIndex(PlayerController->GetMatchId()) && Matches[PlayerController->GetMatchId()].bReady;
+}
+
+ULevel* AMatchManager::GetMatchLevel(int32 MatchId) const
+{
+	if (MatchId == 0)
+	{
+		return GetWorld()->PersistentLevel;
+	}
+
+	const ULevelStreaming* ArenaLevel = Matches.IsValidIndex(MatchId) ? Matches[MatchId].ArenaLevel : nullptr;
+	return ArenaLevel ? ArenaLevel->GetLoadedLevel() : nullptr;
+}
+
+void AMatchManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	bool bMatchBecameReady = false;
+
+	for (int32 MatchId = 0; MatchId < Matches.Num(); MatchId++)
+	{
+		FMatchInstance& Match = Matches[MatchId];
+
+		if (!Match.bReady && Match.ArenaLevel && Match.ArenaLevel->IsLevelVisible())
+		{
+			Match.bReady = true;
+			Match.ArenaMemory = (int64)FPlatformMemory::GetStats().UsedPhysical - (int64)Match.MemoryBeforeArena;
+			bMatchBecameReady = true;
+		}
+
+		Match.TickMs += FPlatformTime::ToMilliseconds(MatchCycles[MatchId]);
+		MatchCycles[MatchId] = 0;
+	}
+
+	GameThreadMs += FPlatformTime::ToMilliseconds(GGameThreadTime);
+	NumFrames++;
+
+	// The connections count their bytes per second
+	NextConnectionSample -= DeltaTime;
+	if (NextConnectionSample <= 0.f)
+	{
+		SampleConnections();
+		NextConnectionSample += 1.f;
+	}
+
+	// The players of the new arena were left without a pawn
+	if (bMatchBecameReady)
+	{
+		if (AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>())
+		{
+			GameMode->RestartWaitingPlayers();
+		}
+	}
+}
+
+void AMatchManager::SampleConnections()
+{
+	for (FMatchInstance& Match : Matches)
+	{
+		for (const APlayerController* Player : Match.Players)
+		{
+			if (const UNetConnection* Connection = Player ? Player->GetNetConnection() : nullptr)
+			{
+				Match.InBytesSum += Connection->InBytesPerSecond;
+				Match.OutBytesSum += Connection->OutBytesPerSecond;
+				Match.NumConnectionSamples++;
+			}
+		}
+	}
+}
+
+void AMatchManager::LogReport()
+{
+	if (!bMultiMatch)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("mynet.MatchReport: one match per process, start the server with -Matches=N or set bMultiMatch"));
+		return;
+	}
+
+	const double FrameCount = FMath::Max(NumFrames, 1);
+	const double GameThreadFrameMs = GameThreadMs / FrameCount;
+
+	UE_LOG(LogMyNet, Log, TEXT("mynet.MatchReport: %d matches in one process, game thread %.3f ms/frame over %d frames"), Matches.Num(), GameThreadFrameMs, NumFrames);
+
+	int64 ArenaMemorySum = 0;
+	int32 NumArenas = 0;
+
+	for (int32 MatchId = 0; MatchId < Matches.Num(); MatchId++)
+	{
+		FMatchInstance& Match = Matches[MatchId];
+		const double Samples = FMath::Max(Match.NumConnectionSamples, 1);
+
+		UE_LOG(LogMyNet, Log, TEXT("  match %2d: %2d players, %s, characters %.3f ms/frame, %.0f B/s in, %.0f B/s out per player"),
+			MatchId, Match.Players.Num(), Match.bReady ? TEXT("ready") : TEXT("loading"), Match.TickMs / FrameCount,
+			Match.InBytesSum / Samples, Match.OutBytesSum / Samples);
+
+		if (Match.ArenaLevel && Match.bReady)
+		{
+			ArenaMemorySum += Match.ArenaMemory;
+			NumArenas++;
+		}
+
+		Match.TickMs = 0.0;
+		Match.InBytesSum = 0.0;
+		Match.OutBytesSum = 0.0;
+		Match.NumConnectionSamples = 0;
+	}
+
+	// Every process of a process per match fleet pays for the engine, the modules and the assets, then for its match
+	const double MegaByte = 1024.0 * 1024.0;
+	const double UsedMemory = FPlatformMemory::GetStats().UsedPhysical / MegaByte;
+	const double Baseline = BaselineMemory / MegaByte;
+	const double ArenaAverage = NumArenas > 0 ? ArenaMemorySum / MegaByte / NumArenas : 0.0;
+	const double PerMatch = (UsedMemory - Baseline) / Matches.Num();
+	const double GameplayPerMatch = (UsedMemory - Baseline - ArenaMemorySum / MegaByte) / Matches.Num();
+	const double ProcessPerMatch = Matches.Num() * (Baseline + GameplayPerMatch);
+
+	UE_LOG(LogMyNet, Log, TEXT("  memory: %.1f MB for the process, %.1f MB at startup, %.1f MB per added arena, %.1f MB per match"), UsedMemory, Baseline, ArenaAverage, PerMatch);
+	UE_LOG(LogMyNet, Log, TEXT("  one process per match would take about %.1f MB (%.1f x %d)"), ProcessPerMatch, ProcessPerMatch / Matches.Num(), Matches.Num());
+
+	const double BudgetMs = 1000.0 / FMath::Max(BudgetTickRate, 1.f);
+	const double MatchMs = GameThreadFrameMs / Matches.Num();
+	UE_LOG(LogMyNet, Log, TEXT("  %.3f ms per match and frame, about %.1f matches per core at %.0f Hz"), MatchMs, MatchMs > 0.0 ? BudgetMs / MatchMs : 0.0, BudgetTickRate);
+
+	GameThreadMs = 0.0;
+	NumFrames = 0;
+}
+
+static FAutoConsoleCommandWithWorld MatchReportCmd(
+	TEXT("mynet.MatchReport"),
+	TEXT("Logs the players, tick time and bandwidth of every match hosted by the server, and its memory against one process per match, since the last report"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		AMyNetGameMode* GameMode = World->GetAuthGameMode<AMyNetGameMode>();
+		if (AMatchManager* MatchManager = GameMode ? GameMode->GetMatchManager() : nullptr)
+		{
+			MatchManager->LogReport();
+		}
+		else
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("mynet.MatchReport: only available on the server"));
+		}
+	}));
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "MatchManager.generated.h"
+
+class ULevelStreaming;
+class ULevelStreamingKismet;
+
+/** Upper bound of the matches one server process hosts */
+static const int32 MaxMatchInstances = 16;
+
+/**
+* Adds the time spent in its scope to a match, if the matches are being accounted.
+* Costs a branch otherwise.
+*/
+struct MYNET_API FMatchCostScope
+{
+	explicit FMatchCostScope(int32 InMatchId);
+	~FMatchCostScope();
+
+private:
+	int32 MatchId;
+	uint32 StartCycles;
+};
+
+/** One of the matches hosted by the process */
+USTRUCT()
+struct FMatchInstance
+{
+	GENERATED_BODY()
+
+	/** Where the arena of the match is. The first match plays in the persistent level at the origin */
+	UPROPERTY()
+	FVector Origin = FVector::ZeroVector;
+
+	/** The streamed copy of the arena, null for the first match */
+	UPROPERTY()
+	ULevelStreaming* ArenaLevel = nullptr;
+
+	/** The players of the match */
+	UPROPERTY()
+	TArray<APlayerController*> Players;
+
+	/** True once the arena is loaded and visible and the players can get in */
+	bool bReady = false;
+
+	/** Process memory before the arena got streamed in, then what it took to load */
+	uint64 MemoryBeforeArena = 0;
+	int64 ArenaMemory = 0;
+
+	// Accounting since the last report
+
+	double TickMs = 0.0;
+	double InBytesSum = 0.0;
+	double OutBytesSum = 0.0;
+	int32 NumConnectionSamples = 0;
+};
+
+/**
+* Hosts several independent matches in one server process. Every match gets its own copy of the
+* arena map, streamed in on a grid of ArenaSpacing cells around the persistent level, and its own players.
+* Once every match is full new players are turned away. The distances keep
+* the relevancy, explosions, significance and cosmetic events of the matches apart, the characters
+* also check the match of the viewer. The engine ticks the world on the game thread, so the matches
+* share it, the batched work of the managers spreads over the worker threads as before.
+* Off unless bMultiMatch or -Matches=N. See mynet.MatchReport. Server only.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AMatchManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AMatchManager();
+
+	/** Reads the command line and starts the first match, right after the spawn. Called from InitGame, before any player logs in */
+	void Init();
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns true if the process hosts more than one match */
+	bool IsEnabled() const { return bMultiMatch; }
+
+	/** Puts a new player in the first match with room, starting a new match if they are all full. Returns the match */
+	int32 AddPlayer(APlayerController* Player);
+
+	/** Takes a player out of its match */
+	void RemovePlayer(AController* Player);
+
+	/** Returns true if every match is there and full, no player can get in */
+	bool IsFull() const;
+
+	/** Returns true once the arena of the match of a player is there */
+	bool IsMatchReady(const APlayerController* Player) const;
+
+	/** Returns the level holding the arena of a match, null until it's loaded */
+	ULevel* GetMatchLevel(int32 MatchId) const;
+
+	/** Returns the map streamed in for every match */
+	const FString& GetArenaMap() const { return ArenaMap; }
+
+	/**
+	* Streams in the arena of a match. The package gets a name made from the match, the same on the
+	* server and on the clients, so the objects of the arena resolve across the network.
+	*/
+	static ULevelStreamingKismet* LoadArena(UWorld* World, const FString& ArenaMap, int32 MatchId, const FVector& Origin);
+
+	/** Logs the players, tick time and bandwidth of every match, the memory against one process per match, then starts over */
+	void LogReport();
+
+	/** True while the matches are being accounted */
+	static bool IsAccounting() { return bAccounting; }
+
+	/** Called by FMatchCostScope */
+	static void AddMatchCycles(int32 MatchId, uint32 Cycles) { MatchCycles[MatchId] += Cycles; }
+
+protected:
+	/** If false there is only the one match of the persistent level, the way it was */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	bool bMultiMatch = false;
+
+	/** Matches hosted at most, up to MaxMatchInstances. Overridden by -Matches=N */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	int32 MaxMatches = 4;
+
+	/** Players of a full match. Overridden by -MatchPlayers=N */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	int32 MaxPlayersPerMatch = 16;
+
+	/** Distance between two neighbouring arenas of the grid, well beyond any cull distance */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	float ArenaSpacing = 200000.f;
+
+	/** Package of the map streamed in for every match after the first */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	FString ArenaMap;
+
+	/** Tick rate the matches per core of the report are computed for */
+	UPROPERTY(Config, EditAnywhere, Category = Matches)
+	float BudgetTickRate = 30.f;
+
+private:
+	/** Starts a new match and streams in its arena. Returns its index */
+	int32 CreateMatch();
+
+	/** Returns where the arena of a match goes: the cells of the grid ring after ring around the persistent level */
+	FVector GetArenaOrigin(int32 MatchId) const;
+
+	/** Returns how many arenas fit the grid inside the world bounds */
+	int32 GetMaxArenas() const;
+
+	/** Samples the bytes per second of the connections of every match */
+	void SampleConnections();
+
+	UPROPERTY(Transient)
+	TArray<FMatchInstance> Matches;
+
+	/** Process memory once the first match was loaded, what every process of a process per match fleet pays */
+	uint64 BaselineMemory = 0;
+
+	/** Game thread time since the last report */
+	double GameThreadMs = 0.0;
+	int32 NumFrames = 0;
+
+	float NextConnectionSample = 0.f;
+
+	static bool bAccounting;
+	static uint32 MatchCycles[MaxMatchInstances];
+};
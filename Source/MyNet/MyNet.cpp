@@ -2,6 +2,64 @@
 
 #include "MyNet.h"
 #include "Modules/ModuleManager.h"
+#include "Misc/CommandLine.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MyNet, "MyNet" );
- 
\ No newline at end of file
+
+DEFINE_LOG_CATEGORY(LogMyNet);
+
+static TAutoConsoleVariable<int32> CVarLeanServer(
+	TEXT("mynet.LeanServer"),
+	1,
+	TEXT("Leaves out the cosmetic components and code paths of the characters and bombs.\n")
+	TEXT("0: never, 1: on dedicated servers, 2: everywhere (to compare the variants)\n")
+	TEXT("Read once for the process, set it in the ini or with -LeanServer=N"),
+	ECVF_ReadOnly);
+
+bool IsLeanServer()
+{
+	// The components of the actors come from the class defaults, built with the first call, so it can't change afterwards
+	static const bool bLeanServer = []()
+	{
+		int32 LeanServer = CVarLeanServer.GetValueOnGameThread();
+		FParse::Value(FCommandLine::Get(), TEXT("LeanServer="), LeanServer);
+		return LeanServer == 2 || (LeanServer == 1 && IsRunningDedicatedServer());
+	}();
+
+	return bLeanServer;
+}
+
+DEFINE_STAT(STAT_MyNet_SkippedPropertyCompares);
+DEFINE_STAT(STAT_MyNet_CosmeticEventsSent);
+DEFINE_STAT(STAT_MyNet_CosmeticEventsMerged);
+DEFINE_STAT(STAT_MyNet_CosmeticEventsDropped);
+
+DEFINE_STAT(STAT_MyNet_RpcAccepted);
+DEFINE_STAT(STAT_MyNet_RpcRejected);
+DEFINE_STAT(STAT_MyNet_RpcCoalesced);
+DEFINE_STAT(STAT_MyNet_DamageHitsCoalesced);
+DEFINE_STAT(STAT_MyNet_RewoundHits);
+DEFINE_STAT(STAT_MyNet_AsyncVisibilityTraces);
+
+DEFINE_STAT(STAT_MyNet_SpawnBomb);
+DEFINE_STAT(STAT_MyNet_Explode);
+DEFINE_STAT(STAT_MyNet_RadialDamage);
+DEFINE_STAT(STAT_MyNet_TakeDamage);
+DEFINE_STAT(STAT_MyNet_UpdateCharText);
+DEFINE_STAT(STAT_MyNet_RepNotify);
+DEFINE_STAT(STAT_MyNet_BombIntegrator);
+DEFINE_STAT(STAT_MyNet_LiveBombs);
+DEFINE_STAT(STAT_MyNet_ArmedBombs);
+DEFINE_STAT(STAT_MyNet_SpawnBombRpcs);
+DEFINE_STAT(STAT_MyNet_TakeDamageRpcs);
+DEFINE_STAT(STAT_MyNet_StatsBitsSent);
+DEFINE_STAT(STAT_MyNet_LightBombBitsSent);
+DEFINE_STAT(STAT_MyNet_MoveBitsSent);
+DEFINE_STAT(STAT_MyNet_MoveCorrections);
+DEFINE_STAT(STAT_MyNet_EventLogBytes);
+DEFINE_STAT(STAT_MyNet_ExplosionQueueMemory);
+DEFINE_STAT(STAT_MyNet_CosmeticEventMemory);
+DEFINE_STAT(STAT_MyNet_DamageAccumulatorMemory);
+DEFINE_STAT(STAT_MyNet_TicksSaved);
+DEFINE_STAT(STAT_MyNet_NetUpdatesSaved);
+DEFINE_STAT(STAT_MyNet_NetPrioritiesLowered);
\ No newline at end of file
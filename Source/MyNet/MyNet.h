@@ -3,4 +3,57 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "Net/UnrealNetwork.h"
\ No newline at end of file
+#include "Stats/Stats.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMyNet, Log, All);
+
+/**
+* Returns true if the cosmetic only components and code paths (cameras, texts, materials, particles)
+* are left out. That's the case on dedicated servers, see mynet.LeanServer.
+* Fixed for the whole process, the class defaults and every spawned actor agree on it.
+*/
+MYNET_API bool IsLeanServer();
+
+DECLARE_STATS_GROUP(TEXT("MyNet"), STATGROUP_MyNet, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Skipped property comparisons"), STAT_MyNet_SkippedPropertyCompares, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Cosmetic events sent"), STAT_MyNet_CosmeticEventsSent, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Cosmetic events merged"), STAT_MyNet_CosmeticEventsMerged, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Cosmetic events dropped"), STAT_MyNet_CosmeticEventsDropped, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Server RPCs accepted"), STAT_MyNet_RpcAccepted, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Server RPCs rejected"), STAT_MyNet_RpcRejected, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Server RPCs coalesced"), STAT_MyNet_RpcCoalesced, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage hits coalesced"), STAT_MyNet_DamageHitsCoalesced, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lag compensated explosion hits"), STAT_MyNet_RewoundHits, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Async explosion visibility traces"), STAT_MyNet_AsyncVisibilityTraces, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SpawnBomb"), STAT_MyNet_SpawnBomb, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bomb Explode"), STAT_MyNet_Explode, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Radial damage dispatch"), STAT_MyNet_RadialDamage, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TakeDamage"), STAT_MyNet_TakeDamage, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateCharText"), STAT_MyNet_UpdateCharText, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RepNotify"), STAT_MyNet_RepNotify, STATGROUP_MyNet, MYNET_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bomb integrator"), STAT_MyNet_BombIntegrator, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live bombs"), STAT_MyNet_LiveBombs, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Armed bombs"), STAT_MyNet_ArmedBombs, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ServerSpawnBomb received"), STAT_MyNet_SpawnBombRpcs, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ServerTakeDamage received"), STAT_MyNet_TakeDamageRpcs, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Character stats bits sent"), STAT_MyNet_StatsBitsSent, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Light bomb array bits sent"), STAT_MyNet_LightBombBitsSent, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Packed move bits sent"), STAT_MyNet_MoveBitsSent, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Move corrections received"), STAT_MyNet_MoveCorrections, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Event log bytes recorded"), STAT_MyNet_EventLogBytes, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Explosion queue"), STAT_MyNet_ExplosionQueueMemory, STATGROUP_MyNet, MYNET_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Cosmetic event queue"), STAT_MyNet_CosmeticEventMemory, STATGROUP_MyNet, MYNET_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Damage accumulator"), STAT_MyNet_DamageAccumulatorMemory, STATGROUP_MyNet, MYNET_API);
+
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Ticks saved by significance"), STAT_MyNet_TicksSaved, STATGROUP_MyNet, MYNET_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Net updates saved by significance"), STAT_MyNet_NetUpdatesSaved, STATGROUP_MyNet, MYNET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net priorities lowered by significance"), STAT_MyNet_NetPrioritiesLowered, STATGROUP_MyNet, MYNET_API);
\ No newline at end of file
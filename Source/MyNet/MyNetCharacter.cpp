@@ -1,6 +1,19 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "MyNetCharacter.h"
+#include "MyNet.h"
+#include "MyNetGameMode.h"
+#include "MyNetPlayerController.h"
+#include "BombPool.h"
+#include "LightBombManager.h"
+#include "ExplosionManager.h"
+#include "DamageAccumulator.h"
+#include "LoadTestRecorder.h"
+#include "MyNetProfiler.h"
+#include "StartupPreloader.h"
+#include "MatchManager.h"
+#include "MatchEventLog.h"
+#include "ActorSignificanceManager.h"
 #include "Kismet/HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -8,11 +21,15 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "EngineUtils.h"
+#include "Serialization/ArchiveCountMem.h"
 
 //////////////////////////////////////////////////////////////////////////
 // AMyNetCharacter
 
-AMyNetCharacter::AMyNetCharacter()
+AMyNetCharacter::AMyNetCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMyNetCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -32,16 +49,22 @@ AMyNetCharacter::AMyNetCharacter()
 	GetCharacterMovement()->JumpZVelocity = 600.f;
 	GetCharacterMovement()->AirControl = 0.2f;
 
-	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(RootComponent);
-	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
-	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	// Nobody looks through the camera or reads the text on a dedicated server, leave them out
+	const bool bLeanServer = IsLeanServer();
 
-	// Create a follow camera
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
-	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	if (!bLeanServer)
+	{
+		// Create a camera boom (pulls in towards the player if there is a collision)
+		CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+		CameraBoom->SetupAttachment(RootComponent);
+		CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
+		CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+
+		// Create a follow camera
+		FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
+		FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
+		FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	}
 
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
@@ -49,9 +72,12 @@ AMyNetCharacter::AMyNetCharacter()
 
 	// ---------------- Network Logic
 	// -----------------------------
-	CharText = CreateDefaultSubobject<UTextRenderComponent>(TEXT("CharText"));
-	CharText->SetRelativeLocation(FVector(0, 0, 100));
-	CharText->SetupAttachment(RootComponent);
+	if (!bLeanServer)
+	{
+		CharText = CreateDefaultSubobject<UTextRenderComponent>(TEXT("CharText"));
+		CharText->SetRelativeLocation(FVector(0, 0, 100));
+		CharText->SetupAttachment(RootComponent);
+	}
 
 	bReplicates = true;
 }
@@ -153,96 +179,357 @@ void AMyNetCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutL
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	//Tell the engine to call the OnRep_Health and OnRep_BombCount each time
-	//a variable changes
-	DOREPLIFETIME(AMyNetCharacter, Health);
-	DOREPLIFETIME(AMyNetCharacter, BombCount);
+	//Tell the engine to call the OnRep_Stats each time
+	//the health or the bomb count changes
+	DOREPLIFETIME(AMyNetCharacter, Stats);
+	DOREPLIFETIME_CONDITION(AMyNetCharacter, ThrowAck, COND_OwnerOnly);
 }
 
+void AMyNetCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Stats only change in a handful of places which mark them, don't compare them otherwise
+	const bool bReplicateStats = StatsDirty.Consume(this, 2);
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AMyNetCharacter, Stats, bReplicateStats);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AMyNetCharacter, ThrowAck, bReplicateStats);
+}
 
-void AMyNetCharacter::OnRep_Health()
+bool AMyNetCharacter::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
 {
-	UpdateCharText();
+	// Called for every channel the character got replicated on
+	StatsDirty.NotifyReplicated();
+
+	return Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+}
+
+bool AMyNetCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// Nothing of another match is
+	const AMyNetPlayerController* Viewer = Cast<AMyNetPlayerController>(RealViewer);
+	if (Viewer && Viewer->GetMatchId() != MatchId)
+	{
+		return false;
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+float AMyNetCharacter::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	const float Priority = Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	AActorSignificanceManager* SignificanceManager = GameMode ? GameMode->GetSignificanceManager() : nullptr;
+	return SignificanceManager ? SignificanceManager->ScaleNetPriority(Priority, this, ViewPos) : Priority;
+}
+
+bool FCharacterStats::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 QuantizedHealth = 0;
+	uint32 NetBombCount = 0;
+
+	if (Ar.IsSaving())
+	{
+		QuantizedHealth = (uint32)FMath::Clamp(FMath::RoundToInt(Health * HealthScale), 0, (int32)MaxQuantizedHealth);
+		NetBombCount = (uint32)FMath::Clamp(BombCount, 0, (int32)MaxNetBombCount);
+	}
+
+	Ar.SerializeInt(QuantizedHealth, MaxQuantizedHealth + 1);
+	Ar.SerializeInt(NetBombCount, MaxNetBombCount + 1);
+
+	if (Ar.IsSaving())
+	{
+		MYNET_INC_COUNTER(STAT_MyNet_StatsBitsSent, StatsBitsSent, FMath::CeilLogTwo(MaxQuantizedHealth + 1) + FMath::CeilLogTwo(MaxNetBombCount + 1));
+	}
+
+	if (Ar.IsLoading())
+	{
+		Health = (float)QuantizedHealth / HealthScale;
+		BombCount = (int32)NetBombCount;
+	}
+
+	bOutSuccess = true;
+	return true;
 }
 
-void AMyNetCharacter::OnRep_BombCount()
+void AMyNetCharacter::OnRep_Stats()
 {
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
 	UpdateCharText();
 }
 
 void AMyNetCharacter::InitHealth()
 {
-	Health = MaxHealth;
+	Stats.Health = MaxHealth;
+	StatsDirty.Mark();
 	UpdateCharText();
 }
 
 void AMyNetCharacter::InitBombCount()
 {
-	BombCount = MaxBombCount;
+	Stats.BombCount = MaxBombCount;
+	StatsDirty.Mark();
 	UpdateCharText();
 }
 
 void AMyNetCharacter::UpdateCharText()
 {
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_UpdateCharText, UpdateCharText);
+
+	// Lean server, nothing to show the text on
+	if (!CharText)
+	{
+		return;
+	}
+
 	// Create string that will display the health and bomb values;
-	FString NextText = FString("Health: ") + FString::SanitizeFloat(Health) +
-		FString(" BombCount: ") + FString::FromInt(BombCount);
+	FString NextText = FString("Health: ") + FString::SanitizeFloat(Stats.Health) +
+		FString(" BombCount: ") + FString::FromInt(GetPredictedBombCount());
 
 
 	// Set the created string to the render comp
 	CharText->SetText(FText::FromString(NextText));
 }
 
+void AMyNetCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// The constructor didn't create them, but the subobject templates of a Blueprint cooked by a full editor come back with its data
+	if (IsLeanServer())
+	{
+		TArray<UActorComponent*> Components;
+		GetLeanServerComponents(Components);
+
+		for (UActorComponent* Component : Components)
+		{
+			Component->DestroyComponent();
+		}
+
+		CameraBoom = nullptr;
+		FollowCamera = nullptr;
+		CharText = nullptr;
+	}
+}
+
+void AMyNetCharacter::GetLeanServerComponents(TArray<UActorComponent*>& OutComponents) const
+{
+	for (UActorComponent* Component : { (UActorComponent*)CameraBoom, (UActorComponent*)FollowCamera, (UActorComponent*)CharText })
+	{
+		if (Component)
+		{
+			OutComponents.Add(Component);
+		}
+	}
+}
+
 void AMyNetCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Anything above this would get clamped by the stats replication
+	ensureMsgf(MaxHealth <= FCharacterStats::GetMaxNetHealth() && MaxBombCount <= (int32)FCharacterStats::MaxNetBombCount,
+		TEXT("%s: MaxHealth or MaxBombCount don't fit in the replicated stats"), *GetName());
+
 	InitHealth();
 	InitBombCount();
+
+	// The significance manager scales this, not whatever it set last
+	BaseNetUpdateFrequency = NetUpdateFrequency;
+
+	// Have the bombs of this character ready before the first throw
+	if (ABombPool* BombPool = GetBombPool())
+	{
+		BombPool->Prewarm(BombActorBP);
+	}
+
+	// Let the server know about a new possible explosion victim
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (AExplosionManager* ExplosionManager = GameMode ? GameMode->GetExplosionManager() : nullptr)
+	{
+		ExplosionManager->RegisterCharacter(this);
+	}
+}
+
+void AMyNetCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (AExplosionManager* ExplosionManager = GameMode ? GameMode->GetExplosionManager() : nullptr)
+	{
+		ExplosionManager->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// ---------------- Movement
+// -----------------------------
+
+void AMyNetCharacter::ServerMovePacked_Implementation(const FMyNetMovePacket& Packet)
+{
+	if (UMyNetCharacterMovementComponent* MovementComponent = Cast<UMyNetCharacterMovementComponent>(GetCharacterMovement()))
+	{
+		MovementComponent->ServerMovePacked(Packet);
+	}
+}
+
+bool AMyNetCharacter::ServerMovePacked_Validate(const FMyNetMovePacket& Packet)
+{
+	// The decoded values are finite by construction, only the raw floats can be broken
+	return FMath::IsFinite(Packet.TimeStamp) && FMath::IsFinite(Packet.PendingTimeStamp);
+}
+
+// ---------------- Bots
+// -----------------------------
+
+void AMyNetCharacter::ApplyBotInput(float Forward, float Right, bool bJump, bool bThrowBomb)
+{
+	MoveForward(Forward);
+	MoveRight(Right);
+
+	if (bJump)
+	{
+		Jump();
+	}
+	else
+	{
+		StopJumping();
+	}
+
+	if (bThrowBomb)
+	{
+		AttempToSpawnBomb();
+	}
+}
+
+void AMyNetCharacter::Tick(float DeltaSeconds)
+{
+	FLoadTestScope LoadTestScope(ELoadTestScope::Character);
+	FMatchCostScope MatchCostScope(MatchId);
+
+	Super::Tick(DeltaSeconds);
 }
 
 // ---------------- Network bombing
 // -----------------------------
 float AMyNetCharacter::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_TakeDamage, TakeDamage);
+
+	// Several hits in a frame become one update at the end of it
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (ADamageAccumulator* DamageAccumulator = GameMode ? GameMode->GetDamageAccumulator() : nullptr)
+	{
+		DamageAccumulator->AddDamage(this, Damage, DamageEvent, EventInstigator, DamageCauser);
+	}
+	else
+	{
+		ApplyDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
+	}
+
+	// The damage actually applied, now or by the accumulator at the end of the frame, all of it either way
+	return Damage;
+}
+
+void AMyNetCharacter::ApplyDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	FLoadTestScope LoadTestScope(ELoadTestScope::Character);
+	FMatchCostScope MatchCostScope(MatchId);
+
 	Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	if (AMatchEventRecorder* EventRecorder = GameMode ? GameMode->GetEventRecorder() : nullptr)
+	{
+		EventRecorder->RecordDamage(this, Damage, EventInstigator);
+	}
+
 
-	// Decrease the character's hp
-	Health -= Damage;
-	if (Health <= 0)
+	// Decrease the character's hp, respawning at full health when it runs out
+	Stats.Health -= Damage;
+	if (Stats.Health <= 0)
 	{
-		InitHealth();
+		Stats.Health = MaxHealth;
 	}
+	StatsDirty.Mark();
 
 	// Call the update text on the local client
 	// OnRep_health will be changed in every other client so the cahracter's text
 	// will be contain a text with the right values
 	UpdateCharText();
-
-	return Health;
 }
 
 void AMyNetCharacter::ServerTakeDamage_Implementation(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
+	MYNET_INC_COUNTER(STAT_MyNet_TakeDamageRpcs, TakeDamageRpcs, 1);
+
+	// Over budget, fold the hit into one that gets applied once the budget allows it
+	AMyNetPlayerController* PlayerController = GetMyNetController();
+	if (PlayerController && !PlayerController->ConsumeRpcBudget(ERpcBudget::TakeDamage))
+	{
+		PlayerController->CoalesceRpc(ERpcBudget::TakeDamage);
+
+		CoalescedDamage += Damage;
+		CoalescedDamageType = DamageEvent.DamageTypeClass;
+		CoalescedInstigator = EventInstigator;
+		CoalescedDamageCauser = DamageCauser;
+
+		if (!GetWorldTimerManager().IsTimerActive(CoalescedDamageHandle))
+		{
+			const float Delay = FMath::Max(PlayerController->GetRpcBudgetDelay(ERpcBudget::TakeDamage), KINDA_SMALL_NUMBER);
+			GetWorldTimerManager().SetTimer(CoalescedDamageHandle, this, &AMyNetCharacter::FlushCoalescedDamage, Delay, false);
+		}
+		return;
+	}
+
 	TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 }
 
 
 bool AMyNetCharacter::ServerTakeDamage_Validate(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	// Assume that everithing is  ok withour any futher checks and return true
-	return true;
+	// Only a broken or cheating client sends a negative (healing) or non finite damage
+	return Damage >= 0.f && FMath::IsFinite(Damage);
+}
+
+void AMyNetCharacter::FlushCoalescedDamage()
+{
+	if (CoalescedDamage <= 0.f)
+	{
+		return;
+	}
+
+	// Still over budget, wait for the next token
+	AMyNetPlayerController* PlayerController = GetMyNetController();
+	if (PlayerController && !PlayerController->ConsumeRpcBudget(ERpcBudget::TakeDamage))
+	{
+		const float Delay = FMath::Max(PlayerController->GetRpcBudgetDelay(ERpcBudget::TakeDamage), KINDA_SMALL_NUMBER);
+		GetWorldTimerManager().SetTimer(CoalescedDamageHandle, this, &AMyNetCharacter::FlushCoalescedDamage, Delay, false);
+		return;
+	}
+
+	const float Damage = CoalescedDamage;
+	CoalescedDamage = 0.f;
+
+	TakeDamage(Damage, FDamageEvent(CoalescedDamageType), CoalescedInstigator.Get(), CoalescedDamageCauser.Get());
+}
+
+AMyNetPlayerController* AMyNetCharacter::GetMyNetController() const
+{
+	return Cast<AMyNetPlayerController>(GetController());
 }
 
 void AMyNetCharacter::AttempToSpawnBomb()
 {
 	// If we don't have authority, ameaning that we're not the server
-	// tell the server to spawn the bomb.
+	// show the throw right away and tell the server to spawn the bomb.
 	// IF we're the server, just spawn the bomb = we trust ourselfs.
 	if (Role < ROLE_Authority)
 	{
-		ServerSpawnBomb();
+		PredictThrow();
 	}
 	else
 	{
@@ -250,27 +537,423 @@ void AMyNetCharacter::AttempToSpawnBomb()
 	}
 }
 
-void AMyNetCharacter::ServerSpawnBomb_Implementation()
+void AMyNetCharacter::ServerSpawnBomb_Implementation(uint8 ThrowId)
+{
+	MYNET_INC_COUNTER(STAT_MyNet_SpawnBombRpcs, SpawnBombRpcs, 1);
+
+	// Over budget, drop the call before it does any work
+	AMyNetPlayerController* PlayerController = GetMyNetController();
+	if (PlayerController && !PlayerController->ConsumeRpcBudget(ERpcBudget::SpawnBomb))
+	{
+		PlayerController->RejectRpc(ERpcBudget::SpawnBomb);
+		AcknowledgeThrow(ThrowId, true);
+		return;
+	}
+
+	// The client already shows this throw, tell it to take it back
+	if (!HasBombs())
+	{
+		AcknowledgeThrow(ThrowId, true);
+		return;
+	}
+
+	AcknowledgeThrow(ThrowId, false);
+	SpawnBomb(ThrowId);
+}
+
+void AMyNetCharacter::AcknowledgeThrow(uint8 ThrowId, bool bRejected)
 {
-	SpawnBomb();
+	// The throws of a client come in order, the older ones shift up the mask
+	const uint8 Shift = ThrowId - ThrowAck.LastThrowId;
+	ThrowAck.RejectedMask = Shift < 32 ? ThrowAck.RejectedMask << Shift : 0;
+	ThrowAck.RejectedMask |= bRejected ? 1 : 0;
+
+	// Arrives together with the bomb count, so the client can stop predicting this throw
+	ThrowAck.LastThrowId = ThrowId;
+	StatsDirty.Mark();
 }
 
-bool AMyNetCharacter::ServerSpawnBomb_Validate()
+bool AMyNetCharacter::ServerSpawnBomb_Validate(uint8 ThrowId)
 {
 	return true;
 }
 
-void AMyNetCharacter::SpawnBomb()
+void AMyNetCharacter::SpawnBomb(uint8 ThrowId)
 {
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_SpawnBomb, SpawnBomb);
+
+	if (!HasBombs())
+	{
+		return;
+	}
+
+	FStartupCostScope StartupCostScope(GetWorld(), EStartupCost::Throw);
+
 	// Decrease the bomb count and update the text in teh local client
-	// OnRep_BombCount will be called in every other client
-	BombCount--;
+	// OnRep_Stats will be called in every other client
+	Stats.BombCount--;
+	StatsDirty.Mark();
 	UpdateCharText();
 
 	FActorSpawnParameters SpawnParameters;
 	SpawnParameters.Instigator = this;
 	SpawnParameters.Owner = GetController();
 
-	// Spawn the bomb
-	GetWorld()->SpawnActor<ABomb>(BombActorBP, GetActorLocation() + GetActorForwardVector() * 200, GetActorRotation(), SpawnParameters);
-}
\ No newline at end of file
+	const FVector SpawnLocation = GetBombSpawnLocation();
+
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	ALightBombManager* LightBombManager = GameMode ? GameMode->GetLightBombManager() : nullptr;
+
+	// In container mode the bomb is only an entry of the light bomb manager.
+	// Otherwise take the bomb from the pool if there is one, spawn it if not
+	if (BombSpawnMode == EBombSpawnMode::Container && LightBombManager)
+	{
+		LightBombManager->LaunchBomb(BombActorBP, SpawnLocation, GetActorRotation(), this, GetController());
+	}
+	else
+	{
+		ABomb* Bomb = nullptr;
+		if (ABombPool* BombPool = GetBombPool())
+		{
+			Bomb = BombPool->AcquireBomb(BombActorBP, SpawnLocation, GetActorRotation(), this, GetController());
+		}
+		else
+		{
+			Bomb = GetWorld()->SpawnActor<ABomb>(BombActorBP, SpawnLocation, GetActorRotation(), SpawnParameters);
+		}
+
+		// Lets the throwing client swap its predicted bomb for this one
+		if (Bomb)
+		{
+			Bomb->SetThrowId(ThrowId);
+		}
+
+		if (AMatchEventRecorder* EventRecorder = Bomb && GameMode ? GameMode->GetEventRecorder() : nullptr)
+		{
+			EventRecorder->RecordBombSpawn(Bomb, this, Bomb->GetActorLocation(), Bomb->GetProjectileMovement()->Velocity);
+		}
+	}
+}
+
+ABombPool* AMyNetCharacter::GetBombPool() const
+{
+	// Only the server has a game mode, and so a pool
+	AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+	return GameMode ? GameMode->GetBombPool() : nullptr;
+}
+
+// ---------------- Throw prediction
+// -----------------------------
+
+void AMyNetCharacter::PredictThrow()
+{
+	if (!HasBombs())
+	{
+		return;
+	}
+
+	FStartupCostScope StartupCostScope(GetWorld(), EStartupCost::PredictedThrow);
+
+	const uint8 ThrowId = NextThrowId++;
+
+	// Never hand out 0, that's the id of the throws that weren't predicted
+	if (NextThrowId == 0)
+	{
+		NextThrowId = 1;
+	}
+
+	FPredictedThrow& Throw = PredictedThrows[PredictedThrows.AddDefaulted()];
+	Throw.ThrowId = ThrowId;
+	Throw.ThrowTime = GetWorld()->GetTimeSeconds();
+	Throw.bAcknowledged = false;
+
+	// The container mode has its own visuals, only the actor bombs get a local proxy
+	if (BombSpawnMode == EBombSpawnMode::Actor && BombActorBP)
+	{
+		const FTransform SpawnTransform(GetActorRotation(), GetBombSpawnLocation());
+
+		ABomb* Proxy = GetWorld()->SpawnActorDeferred<ABomb>(BombActorBP, SpawnTransform, nullptr, this, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (Proxy)
+		{
+			Proxy->SetReplicates(false);
+			Proxy->SetCosmeticProxy();
+			UGameplayStatics::FinishSpawningActor(Proxy, SpawnTransform);
+
+			Proxy->LaunchCosmeticProxy(ABomb::ComputeLaunchVelocity(BombActorBP, GetActorRotation()));
+			Throw.Proxy = Proxy;
+		}
+	}
+
+	UpdateCharText();
+
+	GetWorldTimerManager().SetTimer(PredictionTimeoutHandle, this, &AMyNetCharacter::ExpirePredictedThrows, PredictionTimeout, false);
+
+	ServerSpawnBomb(ThrowId);
+}
+
+void AMyNetCharacter::RollbackThrow(int32 Index)
+{
+	if (ABomb* Proxy = PredictedThrows[Index].Proxy.Get())
+	{
+		Proxy->Destroy();
+	}
+
+	PredictedThrows.RemoveAt(Index);
+	UpdateCharText();
+}
+
+int32 AMyNetCharacter::GetPredictedBombCount() const
+{
+	int32 NumPending = 0;
+	for (const FPredictedThrow& Throw : PredictedThrows)
+	{
+		NumPending += Throw.bAcknowledged ? 0 : 1;
+	}
+
+	return Stats.BombCount - NumPending;
+}
+
+void AMyNetCharacter::OnRep_ThrowAck()
+{
+	MYNET_SCOPE_CYCLE_COUNTER(STAT_MyNet_RepNotify, RepNotify);
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	// Reliable RPCs are processed in order, so every throw up to the acked one is done
+	for (int32 Index = PredictedThrows.Num() - 1; Index >= 0; Index--)
+	{
+		FPredictedThrow& Throw = PredictedThrows[Index];
+
+		// Throws after the acked one wrap around to a large age
+		const uint8 Age = ThrowAck.LastThrowId - Throw.ThrowId;
+		if (Throw.bAcknowledged || Age >= 128)
+		{
+			continue;
+		}
+
+		// Refused, take it back
+		if (Age < 32 && (ThrowAck.RejectedMask & (1u << Age)) != 0)
+		{
+			RollbackThrow(Index);
+			continue;
+		}
+
+		Throw.bAcknowledged = true;
+
+		const float Latency = TimeSeconds - Throw.ThrowTime;
+		ThrowLatencySum += Latency;
+		MaxThrowLatency = FMath::Max(MaxThrowLatency, Latency);
+		NumAckedThrows++;
+
+		// Nothing left to hand over
+		if (!Throw.Proxy.IsValid())
+		{
+			PredictedThrows.RemoveAt(Index);
+		}
+	}
+
+	UpdateCharText();
+}
+
+void AMyNetCharacter::ExpirePredictedThrows()
+{
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	bool bAnyUnacknowledged = false;
+
+	for (int32 Index = PredictedThrows.Num() - 1; Index >= 0; Index--)
+	{
+		const FPredictedThrow& Throw = PredictedThrows[Index];
+
+		// The server took it, the proxy waits for the real bomb to hand over to. Forgotten once the proxy is gone by itself
+		if (Throw.bAcknowledged)
+		{
+			if (!Throw.Proxy.IsValid())
+			{
+				PredictedThrows.RemoveAt(Index);
+			}
+			continue;
+		}
+
+		if (TimeSeconds - Throw.ThrowTime >= PredictionTimeout)
+		{
+			UE_LOG(LogMyNet, Verbose, TEXT("%s: throw %d timed out"), *GetName(), Throw.ThrowId);
+			RollbackThrow(Index);
+			continue;
+		}
+
+		bAnyUnacknowledged = true;
+	}
+
+	// Check again for the remaining ones
+	if (bAnyUnacknowledged)
+	{
+		GetWorldTimerManager().SetTimer(PredictionTimeoutHandle, this, &AMyNetCharacter::ExpirePredictedThrows, PredictionTimeout, false);
+	}
+}
+
+void AMyNetCharacter::OnThrowConfirmed(uint8 ThrowId, ABomb* Bomb)
+{
+	const int32 Index = PredictedThrows.IndexOfByPredicate([ThrowId](const FPredictedThrow& Throw) { return Throw.ThrowId == ThrowId; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	FPredictedThrow& Throw = PredictedThrows[Index];
+
+	// The real bomb continues from where the player already sees it
+	if (ABomb* Proxy = Throw.Proxy.Get())
+	{
+		Bomb->TakeOverProxy(Proxy);
+		Proxy->Destroy();
+	}
+	Throw.Proxy = nullptr;
+
+	// Still counted until the bomb count from the server reflects it
+	if (Throw.bAcknowledged)
+	{
+		PredictedThrows.RemoveAt(Index);
+	}
+}
+
+void AMyNetCharacter::LogThrowLatency() const
+{
+	UE_LOG(LogMyNet, Log, TEXT("%s: %d acknowledged throws, average %.1f ms, max %.1f ms, %d pending"), *GetName(), NumAckedThrows,
+		NumAckedThrows > 0 ? 1000.f * ThrowLatencySum / NumAckedThrows : 0.f, 1000.f * MaxThrowLatency, PredictedThrows.Num());
+}
+
+static FAutoConsoleCommandWithWorld ThrowLatencyCmd(
+	TEXT("mynet.ThrowLatency"),
+	TEXT("Logs how long the server took to acknowledge the predicted throws of the local characters. Use with Net PktLag to emulate latency"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AMyNetCharacter> It(World); It; ++It)
+		{
+			if (It->IsLocallyControlled())
+			{
+				It->LogThrowLatency();
+			}
+		}
+	}));
+
+static FAutoConsoleCommandWithArgs StatsBandwidthCmd(
+	TEXT("mynet.StatsBandwidth"),
+	TEXT("mynet.StatsBandwidth [NumClients=64]. Compares the bits sent per character stats change, packed against two plain properties"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumClients = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64, 1);
+
+		FCharacterStats Stats;
+		Stats.Health = 87.5f;
+		Stats.BombCount = 2;
+
+		FNetBitWriter Writer(nullptr, 64);
+		bool bSuccess = false;
+		Stats.NetSerialize(Writer, nullptr, bSuccess);
+
+		// Every replicated property also costs a handle, packed in about a byte with so few properties
+		const int64 HandleBits = 8;
+		const int64 PackedBits = HandleBits + Writer.GetNumBits();
+		const int64 LegacyBits = 2 * (HandleBits + 32);
+
+		UE_LOG(LogMyNet, Log, TEXT("mynet.StatsBandwidth: per change and client, packed %lld bits, separate properties %lld bits"), PackedBits, LegacyBits);
+		UE_LOG(LogMyNet, Log, TEXT("  every character changing once, %d clients: packed %lld bytes, separate properties %lld bytes"),
+			NumClients, (PackedBits * NumClients * NumClients + 7) / 8, (LegacyBits * NumClients * NumClients + 7) / 8);
+	}));
+
+/**
+* Spawns Count actors of a class, returns the average construction time in ms and the average memory of the actor and its components.
+* OutLeanBytes is the part of it a lean server leaves out, 0 when running lean
+*/
+static void MeasureActorVariant(UWorld* World, UClass* Class, int32 Count, double& OutMilliseconds, int64& OutBytes, int64& OutLeanBytes)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	TArray<AActor*> Actors;
+	Actors.Reserve(Count);
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		Actors.Add(World->SpawnActor<AActor>(Class, FVector(0.f, 0.f, -10000.f), FRotator::ZeroRotator, SpawnParameters));
+	}
+	OutMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Count;
+
+	OutBytes = 0;
+	OutLeanBytes = 0;
+	for (AActor* Actor : Actors)
+	{
+		if (!Actor)
+		{
+			continue;
+		}
+
+		OutBytes += FArchiveCountMem(Actor).GetMax();
+
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+		for (UActorComponent* Component : Components)
+		{
+			OutBytes += FArchiveCountMem(Component).GetMax();
+		}
+
+		if (const AMyNetCharacter* Character = Cast<AMyNetCharacter>(Actor))
+		{
+			TArray<UActorComponent*> LeanComponents;
+			Character->GetLeanServerComponents(LeanComponents);
+
+			for (UActorComponent* Component : LeanComponents)
+			{
+				OutLeanBytes += FArchiveCountMem(Component).GetMax();
+			}
+		}
+
+		Actor->Destroy();
+	}
+	OutBytes /= Count;
+	OutLeanBytes /= Count;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs LeanReportCmd(
+	TEXT("mynet.LeanReport"),
+	TEXT("mynet.LeanReport [Count=32]. Spawns characters and bombs and logs their construction time and memory. A full server also logs the memory a lean one saves. ")
+	TEXT("The construction times of both only come from two runs: start the same map with -LeanServer=0, run it, restart with -LeanServer=2, run it again and compare the two lines of each class"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		AGameModeBase* GameMode = World->GetAuthGameMode();
+		if (!GameMode)
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("mynet.LeanReport: no game mode, run it on the server"));
+			return;
+		}
+
+		const int32 Count = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 32, 1);
+
+		UClass* CharacterClass = GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf<AMyNetCharacter>() ? *GameMode->DefaultPawnClass : AMyNetCharacter::StaticClass();
+		UClass* BombClass = CharacterClass->GetDefaultObject<AMyNetCharacter>()->BombActorBP;
+		if (!BombClass)
+		{
+			BombClass = ABomb::StaticClass();
+		}
+
+		// The variant is fixed for the process. Its memory is known from the full one, its construction time takes a -LeanServer=2 run
+		for (UClass* Class : { CharacterClass, BombClass })
+		{
+			double Milliseconds;
+			int64 Bytes;
+			int64 LeanBytes;
+			MeasureActorVariant(World, Class, Count, Milliseconds, Bytes, LeanBytes);
+
+			if (IsLeanServer())
+			{
+				UE_LOG(LogMyNet, Log, TEXT("mynet.LeanReport %s, lean, %d actors: %.3f ms %lld bytes per actor. Run it with -LeanServer=0 for the full side"),
+					*Class->GetName(), Count, Milliseconds, Bytes);
+			}
+			else
+			{
+				UE_LOG(LogMyNet, Log, TEXT("mynet.LeanReport %s, %d actors: full %.3f ms %lld bytes per actor, lean %lld bytes per actor (%lld saved). Run it with -LeanServer=2 for the lean construction time"),
+					*Class->GetName(), Count, Milliseconds, Bytes, Bytes - LeanBytes, LeanBytes);
+			}
+		}
+	}));
@@ -7,13 +7,89 @@
 #include "Components/TextRenderComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "Bomb.h"
+#include "DirtyReplication.h"
+#include "MyNetCharacterMovement.h"
 #include "MyNetCharacter.generated.h"
 
+/**
+* The replicated stats of a character.
+* Both values have tiny ranges, so they are sent quantized and bit packed in 16 bits
+* instead of two full 32 bit properties.
+*/
+USTRUCT()
+struct FCharacterStats
+{
+	GENERATED_BODY()
+
+	/** The health of the character */
+	UPROPERTY(VisibleAnywhere, Category = Stats)
+	float Health = 0.f;
+
+	/** The number of bombs that the character carries */
+	UPROPERTY(VisibleAnywhere, Category = Stats)
+	int32 BombCount = 0;
+
+	/** Health is sent in steps of 1 / HealthScale */
+	static const int32 HealthScale = 4;
+
+	/** 12 bits of quantized health */
+	static const uint32 MaxQuantizedHealth = (1 << 12) - 1;
+
+	/** 4 bits of bomb count */
+	static const uint32 MaxNetBombCount = (1 << 4) - 1;
+
+	/** The highest health that survives the quantization */
+	static float GetMaxNetHealth() { return (float)MaxQuantizedHealth / HealthScale; }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterStats> : public TStructOpsTypeTraitsBase2<FCharacterStats>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+* The server's answer to the throws of the owning client.
+* One struct so that the refusals always arrive together with the throw they belong to.
+*/
+USTRUCT()
+struct FThrowAck
+{
+	GENERATED_BODY()
+
+	/** The last throw the server processed, accepted or not */
+	UPROPERTY()
+	uint8 LastThrowId = 0;
+
+	/** Which of the 32 throws up to LastThrowId the server refused, bit N for the throw N before it */
+	UPROPERTY()
+	uint32 RejectedMask = 0;
+};
+
+/** How the thrown bombs get simulated and replicated */
+UENUM()
+enum class EBombSpawnMode : uint8
+{
+	/** Every bomb is its own replicated ABomb actor */
+	Actor,
+
+	/** Bombs are entries of the replicated ALightBombManager container, clients only spawn visuals */
+	Container
+};
+
 UCLASS(config=Game)
 class AMyNetCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	/** Times the private hot paths */
+	friend struct FHotPathBenchmark;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
@@ -22,7 +98,7 @@ class AMyNetCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
 public:
-	AMyNetCharacter();
+	AMyNetCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
@@ -67,43 +143,41 @@ protected:
 	// End of APawn interface
 
 public:
-	/** Returns CameraBoom subobject **/
+	/** Returns CameraBoom subobject, null on a lean server, see IsLeanServer **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
-	/** Returns FollowCamera subobject **/
+	/** Returns FollowCamera subobject, null on a lean server, see IsLeanServer **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
+	/** Fills in the components a lean server leaves out, none on a lean server */
+	void GetLeanServerComponents(TArray<UActorComponent*>& OutComponents) const;
+
+	/** NetUpdateFrequency as it was at BeginPlay, what AActorSignificanceManager scales down */
+	float GetBaseNetUpdateFrequency() const { return BaseNetUpdateFrequency; }
+
 // ---------------- Network Logic
 // -----------------------------
 protected:
 
-	/** The health of the character */
-	UPROPERTY(VisibleAnywhere, Transient, ReplicatedUsing = OnRep_Health, Category = Stats)
-	float Health;
+	/** The health and bomb count of the character, replicated together */
+	UPROPERTY(VisibleAnywhere, Transient, ReplicatedUsing = OnRep_Stats, Category = Stats)
+	FCharacterStats Stats;
 
 	/** The max health of the character */
 	UPROPERTY(EditAnywhere, Category = Stats)
 	float MaxHealth = 100.f;
 
-	/** The number of bombs that the character carries */
-	UPROPERTY(VisibleAnywhere, Transient, ReplicatedUsing = OnRep_BombCount, Category = Stats)
-	int32 BombCount;
-
 	/** The max number of bombs that a character can have */
 	UPROPERTY(EditAnywhere, Category = Stats)
 	int32 MaxBombCount = 3;
 
-	/** Text render component - used instead of UMG, to keep the tutorial short */
+	/** Text render component - used instead of UMG, to keep the tutorial short. Null on a lean server */
 	UPROPERTY(VisibleAnywhere)
 	UTextRenderComponent* CharText;
 
 private:
-	/** Called when the Health viriable gets updated */
-	UFUNCTION()
-	void OnRep_Health();
-
-	/** Called when the BombCount variable gets updated */
+	/** Called when the Stats variable gets updated */
 	UFUNCTION()
-	void OnRep_BombCount();
+	void OnRep_Stats();
 
 	/** Initialize Health */
 	UFUNCTION()
@@ -116,13 +190,36 @@ private:
 	/** Updates the cahracter's textt to match with the updated status */
 	void UpdateCharText();
 
+	/** Tells the replication that Stats changed */
+	FDirtyReplicationFlag StatsDirty;
+
 public:
 
 	/** Marks the properties we wish to replicate */
 	virtual void GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const;
 
+	/** Set at BeginPlay, see GetBaseNetUpdateFrequency */
+	float BaseNetUpdateFrequency = 0.f;
+
+	/** Skips the comparison of Stats when they haven't changed */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Counts the channels the Stats went out on, see FDirtyReplicationFlag */
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	/** Hides the character from the players of the other matches, then runs the default checks */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Lowers the priority for the connections viewing the character from afar, see AActorSignificanceManager */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	/** On a lean server, removes the camera and text components that Blueprints cooked by a full editor still carry */
+	virtual void PostInitializeComponents() override;
+
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 // ---------------- Network bombing
 // -----------------------------
 private:
@@ -139,41 +236,180 @@ private:
 	/** Validates the client. If the result is false teh client will be disconected */
 	bool ServerTakeDamage_Validate(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
 
+	/** Applies the ServerTakeDamage calls that came in over budget as one hit */
+	void FlushCoalescedDamage();
+
+	/** The player controller of this character, for the RPC budget. Null for characters that aren't player controlled */
+	class AMyNetPlayerController* GetMyNetController() const;
+
+	/** Sum of the ServerTakeDamage calls that came in over budget */
+	float CoalescedDamage = 0.f;
+
+	/** Damage type, instigator and causer of the latest coalesced call */
+	TSubclassOf<class UDamageType> CoalescedDamageType;
+	TWeakObjectPtr<AController> CoalescedInstigator;
+	TWeakObjectPtr<AActor> CoalescedDamageCauser;
+
+	FTimerHandle CoalescedDamageHandle;
+
 	// Bomb related functions
 	
 	/** Will try to spawn a bomb */
 	void AttempToSpawnBomb();
 
 	/** Returns true if we can throw a bomb */
-	bool HasBombs() { return BombCount > 0; }
+	bool HasBombs() { return GetPredictedBombCount() > 0; }
 
 	/**
 	* Spawns a bomb. Call this function when you'ar authorized to.
 	* In case you're not authorized, use the ServerSpawnBomb function
+	* @param ThrowId	Id of the client prediction of this throw, handed to the spawned bomb
 	*/
-	void SpawnBomb();
+	void SpawnBomb(uint8 ThrowId = 0);
 
 	/**
 	* SpawnBomb Server version. Call this insted of SpawnBomb when you're a client.
 	* You don't have to generate an implementation for this. It will automaticly call to ServerSpawnBomb_Implementation function
 	*/
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerSpawnBomb();
+	void ServerSpawnBomb(uint8 ThrowId);
 
 	/** Contains tha actual implementain of the ServerSpawnBomb function */
-	void ServerSpawnBomb_Implementation();
+	void ServerSpawnBomb_Implementation(uint8 ThrowId);
 
 	/** validates the client. If the result is false the client will be disconected */
-	bool ServerSpawnBomb_Validate();
+	bool ServerSpawnBomb_Validate(uint8 ThrowId);
+
+	/** Returns the bomb pool of the server, null on clients */
+	class ABombPool* GetBombPool() const;
+
+	/** Where the thrown bombs start from */
+	FVector GetBombSpawnLocation() const { return GetActorLocation() + GetActorForwardVector() * 200; }
+
+// ---------------- Throw prediction
+// -----------------------------
+private:
+	/** A throw the client already shows, waiting for the server to confirm or reject it */
+	struct FPredictedThrow
+	{
+		uint8 ThrowId;
+
+		/** The local bomb shown until the real one arrives */
+		TWeakObjectPtr<ABomb> Proxy;
+
+		/** World time of the throw, to measure how long the confirmation took */
+		float ThrowTime;
+
+		/** True once the server processed the throw and the bomb count reflects it */
+		bool bAcknowledged;
+	};
+
+	/** Throws not confirmed by the server yet. Client only */
+	TArray<FPredictedThrow> PredictedThrows;
+
+	/** Id of the next predicted throw */
+	uint8 NextThrowId = 1;
+
+	/** Unconfirmed throws older than this many seconds are rolled back */
+	UPROPERTY(EditAnywhere, Category = BombProps)
+	float PredictionTimeout = 2.f;
+
+	FTimerHandle PredictionTimeoutHandle;
+
+	// Acknowledgement latency, for tuning
+
+	float ThrowLatencySum = 0.f;
+	float MaxThrowLatency = 0.f;
+	int32 NumAckedThrows = 0;
+
+	/**
+	* The throws the server processed and which of them it refused. Only sent to the owner.
+	* Replicated instead of a reliable RPC per refusal, so a client spamming throws gets no more traffic back
+	*/
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_ThrowAck)
+	FThrowAck ThrowAck;
+
+	/** Called when ThrowAck gets updated */
+	UFUNCTION()
+	void OnRep_ThrowAck();
+
+	/** Records that the server processed a throw. Server only */
+	void AcknowledgeThrow(uint8 ThrowId, bool bRejected);
+
+	/** The bomb count minus the throws still waiting for the server */
+	int32 GetPredictedBombCount() const;
+
+	/** Shows a throw right away and asks the server for the real one */
+	void PredictThrow();
+
+	/** Removes a predicted throw and its proxy */
+	void RollbackThrow(int32 Index);
+
+	/** Rolls back the throws the server never answered. The acknowledged ones keep their proxy until the real bomb arrives */
+	void ExpirePredictedThrows();
 
 public:
-	/** Applies damage to the character */
+	/** Called on the owning client when the real bomb of a predicted throw arrives */
+	void OnThrowConfirmed(uint8 ThrowId, ABomb* Bomb);
+
+	/** Writes the throw confirmation latency to the log */
+	void LogThrowLatency() const;
+
+// ---------------- Movement
+// -----------------------------
+public:
+	/**
+	* The moves of the owning client, packed. Replaces ServerMove and ServerMoveDual, see UMyNetCharacterMovementComponent.
+	* You don't have to generate an implementation. It will automaticly call the ServerMovePacked_Implementation function
+	*/
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerMovePacked(const FMyNetMovePacket& Packet);
+
+	/** Contains the actual implementation of the ServerMovePacked function */
+	void ServerMovePacked_Implementation(const FMyNetMovePacket& Packet);
+
+	/** Validates the client. If the result is false the client will be disconnected */
+	bool ServerMovePacked_Validate(const FMyNetMovePacket& Packet);
+
+// ---------------- Bots
+// -----------------------------
+public:
+	/** Feeds the input of a bot through the same paths as the player input */
+	void ApplyBotInput(float Forward, float Right, bool bJump, bool bThrowBomb);
+
+	/** Counts the tick in the game thread time of the characters during load tests */
+	virtual void Tick(float DeltaSeconds) override;
+
+public:
+	/** Applies damage to the character. On the server the hit is only recorded and applied with the others of the frame */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
 
+	/**
+	* Applies the damage right away. Called by the damage accumulator with the summed hits of a frame.
+	* @param DamageEvent, EventInstigator, DamageCauser	The hit credited with the damage
+	*/
+	void ApplyDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+
+	/** Returns the current health */
+	float GetHealth() const { return Stats.Health; }
+
+	/** Returns the match the character plays in when the server hosts several */
+	int32 GetMatchId() const { return MatchId; }
+
+	/** Server only, set when the character spawns for its player */
+	void SetMatchId(int32 InMatchId) { MatchId = InMatchId; }
+
+private:
+	int32 MatchId = 0;
+
 public:
 	/** Bomb Blueprint */
 	UPROPERTY(EditAnywhere, Category = BombProps)
 	TSubclassOf<ABomb> BombActorBP;
 
+	/** Whether thrown bombs are actors or container entries */
+	UPROPERTY(EditAnywhere, Config, Category = BombProps)
+	EBombSpawnMode BombSpawnMode = EBombSpawnMode::Actor;
+
 };
 
@@ -0,0 +1,409 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MyNetCharacterMovement.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "MyNetProfiler.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/Character.h"
+#include "EngineUtils.h"
+
+/** Directions and magnitudes of the packed acceleration, see QuantizeAcceleration */
+static const int32 AccelDirectionSteps = 1 << 8;
+static const int32 AccelMagnitudeBits = 6;
+static const int32 AccelMagnitudeSteps = (1 << AccelMagnitudeBits) - 1;
+
+// ---------------- FMyNetMovePacket
+// -----------------------------
+
+/** Sends an acceleration code, followed by the whole vector when it didn't fit the packed form */
+static void SerializeAccel(FArchive& Ar, UPackageMap* Map, uint16& AccelCode, FVector& FullAccel, bool& bOutSuccess)
+{
+	uint32 Code = AccelCode;
+	Ar.SerializeInt(Code, FMyNetMovePacket::FullAccelCode + 1);
+	AccelCode = (uint16)Code;
+
+	if (AccelCode == FMyNetMovePacket::FullAccelCode)
+	{
+		FVector_NetQuantize10 NetAccel(FullAccel);
+		bool bAccelSuccess = true;
+		NetAccel.NetSerialize(Ar, Map, bAccelSuccess);
+		FullAccel = NetAccel;
+		bOutSuccess &= bAccelSuccess;
+	}
+}
+
+/** Sends a single bit */
+static bool SerializeBit(FArchive& Ar, bool bValue)
+{
+	uint8 Bit = bValue ? 1 : 0;
+	Ar.SerializeBits(&Bit, 1);
+	return (Bit & 1) != 0;
+}
+
+bool FMyNetMovePacket::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	Ar << TimeStamp;
+	SerializeAccel(Ar, Map, AccelCode, FullAccel, bOutSuccess);
+	Ar << MoveFlags;
+	Ar << View;
+
+	bDual = SerializeBit(Ar, bDual);
+	if (bDual)
+	{
+		Ar << PendingTimeStamp;
+		SerializeAccel(Ar, Map, PendingAccelCode, PendingFullAccel, bOutSuccess);
+		Ar << PendingMoveFlags;
+
+		// The pending move is a frame or two older than the new one, its view is sent as a small delta when it can
+		int32 DeltaYaw = 0;
+		int32 DeltaPitch = 0;
+		if (Ar.IsSaving())
+		{
+			DeltaYaw = (int16)(uint16)((PendingView >> 16) - (View >> 16));
+			DeltaPitch = (int16)(uint16)((PendingView & 0xFFFF) - (View & 0xFFFF));
+		}
+
+		const bool bViewDelta = SerializeBit(Ar, FMath::Abs(DeltaYaw) <= MaxViewDelta && FMath::Abs(DeltaPitch) <= MaxViewDelta);
+		if (bViewDelta)
+		{
+			uint32 NetDeltaYaw = (uint32)(DeltaYaw + MaxViewDelta);
+			uint32 NetDeltaPitch = (uint32)(DeltaPitch + MaxViewDelta);
+			Ar.SerializeInt(NetDeltaYaw, 2 * MaxViewDelta + 1);
+			Ar.SerializeInt(NetDeltaPitch, 2 * MaxViewDelta + 1);
+
+			if (Ar.IsLoading())
+			{
+				const uint16 PendingYaw = (uint16)((View >> 16) + (int32)NetDeltaYaw - MaxViewDelta);
+				const uint16 PendingPitch = (uint16)((View & 0xFFFF) + (int32)NetDeltaPitch - MaxViewDelta);
+				PendingView = ((uint32)PendingYaw << 16) | PendingPitch;
+			}
+		}
+		else
+		{
+			Ar << PendingView;
+		}
+	}
+
+	FVector_NetQuantize100 NetClientLoc(ClientLoc);
+	bool bLocSuccess = true;
+	NetClientLoc.NetSerialize(Ar, Map, bLocSuccess);
+	ClientLoc = NetClientLoc;
+	bOutSuccess &= bLocSuccess;
+
+	Ar << ClientRoll;
+
+	const bool bHasBase = SerializeBit(Ar, ClientMovementBase != nullptr || ClientBaseBoneName != NAME_None);
+	if (bHasBase)
+	{
+		// Measuring the packet without a connection leaves the object reference out
+		UObject* BaseObject = ClientMovementBase;
+		if (Map)
+		{
+			bOutSuccess &= Map->SerializeObject(Ar, UPrimitiveComponent::StaticClass(), BaseObject);
+		}
+		ClientMovementBase = Cast<UPrimitiveComponent>(BaseObject);
+
+		UPackageMap::StaticSerializeName(Ar, ClientBaseBoneName);
+	}
+	else if (Ar.IsLoading())
+	{
+		ClientMovementBase = nullptr;
+		ClientBaseBoneName = NAME_None;
+	}
+
+	Ar << ClientMovementMode;
+
+	return true;
+}
+
+// ---------------- Saved moves
+// -----------------------------
+
+void FSavedMove_MyNet::Clear()
+{
+	Super::Clear();
+
+	AccelCode = 0;
+}
+
+void FSavedMove_MyNet::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData)
+{
+	// Rounds Acceleration through UMyNetCharacterMovementComponent::RoundAcceleration
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	const UMyNetCharacterMovementComponent* MovementComponent = Cast<UMyNetCharacterMovementComponent>(Character->GetCharacterMovement());
+	AccelCode = MovementComponent ? MovementComponent->QuantizeAcceleration(Acceleration) : 0;
+}
+
+bool FSavedMove_MyNet::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	// The combined move is sent with the acceleration of the new one, so only combine if it's what this one would have sent
+	if (AccelCode != static_cast<const FSavedMove_MyNet*>(NewMove.Get())->AccelCode)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+FNetworkPredictionData_Client_MyNet::FNetworkPredictionData_Client_MyNet(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_MyNet::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_MyNet());
+}
+
+// ---------------- UMyNetCharacterMovementComponent
+// -----------------------------
+
+uint16 UMyNetCharacterMovementComponent::QuantizeAcceleration(const FVector& Accel) const
+{
+	if (Accel.IsZero())
+	{
+		return 0;
+	}
+
+	// Walking and falling characters never accelerate up or down, flying and swimming ones send the whole vector
+	if (Accel.Z != 0.f || MaxAcceleration <= 0.f)
+	{
+		return FMyNetMovePacket::FullAccelCode;
+	}
+
+	const int32 Direction = FMath::RoundToInt(FMath::Atan2(Accel.Y, Accel.X) * AccelDirectionSteps / (2.f * PI)) & (AccelDirectionSteps - 1);
+	const int32 Magnitude = FMath::Clamp(FMath::RoundToInt(Accel.Size2D() / MaxAcceleration * AccelMagnitudeSteps), 1, AccelMagnitudeSteps);
+
+	return (uint16)(1 + ((Direction << AccelMagnitudeBits) | Magnitude));
+}
+
+FVector UMyNetCharacterMovementComponent::DequantizeAcceleration(uint16 AccelCode, const FVector& FullAccel) const
+{
+	if (AccelCode == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	if (AccelCode >= FMyNetMovePacket::FullAccelCode)
+	{
+		return FullAccel;
+	}
+
+	const int32 Packed = AccelCode - 1;
+	const float Angle = (Packed >> AccelMagnitudeBits) * (2.f * PI) / AccelDirectionSteps;
+	const float Size = MaxAcceleration * (Packed & AccelMagnitudeSteps) / AccelMagnitudeSteps;
+
+	return FVector(FMath::Cos(Angle) * Size, FMath::Sin(Angle) * Size, 0.f);
+}
+
+FVector UMyNetCharacterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	if (!bUsePackedMoves)
+	{
+		return Super::RoundAcceleration(InAccel);
+	}
+
+	// The client simulates with what the server will receive, a packed code decodes to the same vector on both sides
+	const uint16 AccelCode = QuantizeAcceleration(InAccel);
+	return AccelCode == FMyNetMovePacket::FullAccelCode ? Super::RoundAcceleration(InAccel) : DequantizeAcceleration(AccelCode, FVector::ZeroVector);
+}
+
+FNetworkPredictionData_Client* UMyNetCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UMyNetCharacterMovementComponent* MutableThis = const_cast<UMyNetCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MyNet(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UMyNetCharacterMovementComponent::CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove)
+{
+	check(NewMove != nullptr);
+
+	AMyNetCharacter* MyNetCharacter = Cast<AMyNetCharacter>(CharacterOwner);
+	FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	const FSavedMove_Character* PendingMove = ClientData->PendingMove.Get();
+
+	NumPacketsSent++;
+
+	// Root motion moves carry more than the packet, they keep the stock RPCs
+	if (!bUsePackedMoves || !MyNetCharacter || NewMove->bHasRootMotionFromAnimation || (PendingMove && PendingMove->bHasRootMotionFromAnimation))
+	{
+		Super::CallServerMove(NewMove, OldMove);
+		return;
+	}
+
+	// Resent important moves are already small
+	if (OldMove)
+	{
+		CharacterOwner->ServerMoveOld(OldMove->TimeStamp, OldMove->Acceleration, OldMove->GetCompressedFlags());
+	}
+
+	FMyNetMovePacket Packet;
+	Packet.TimeStamp = NewMove->TimeStamp;
+	Packet.AccelCode = static_cast<const FSavedMove_MyNet*>(NewMove)->AccelCode;
+	Packet.FullAccel = NewMove->Acceleration;
+	Packet.MoveFlags = NewMove->GetCompressedFlags();
+	Packet.View = PackYawAndPitchTo32(NewMove->SavedControlRotation.Yaw, NewMove->SavedControlRotation.Pitch);
+
+	if (PendingMove)
+	{
+		Packet.bDual = true;
+		Packet.PendingTimeStamp = PendingMove->TimeStamp;
+		Packet.PendingAccelCode = static_cast<const FSavedMove_MyNet*>(PendingMove)->AccelCode;
+		Packet.PendingFullAccel = PendingMove->Acceleration;
+		Packet.PendingMoveFlags = PendingMove->GetCompressedFlags();
+		Packet.PendingView = PackYawAndPitchTo32(PendingMove->SavedControlRotation.Yaw, PendingMove->SavedControlRotation.Pitch);
+	}
+
+	Packet.ClientRoll = FRotator::CompressAxisToByte(NewMove->SavedControlRotation.Roll);
+	Packet.ClientMovementBase = NewMove->EndBase.Get();
+	Packet.ClientBaseBoneName = NewMove->EndBoneName;
+	Packet.ClientLoc = MovementBaseUtility::UseRelativeLocation(Packet.ClientMovementBase) ? NewMove->SavedRelativeLocation : NewMove->SavedLocation;
+	Packet.ClientMovementMode = NewMove->MovementMode;
+
+	// Measured without the connection, so a movement base reference isn't counted
+	FNetBitWriter Writer(nullptr, 512);
+	bool bSuccess = true;
+	Packet.NetSerialize(Writer, nullptr, bSuccess);
+
+	NumBitsSent += Writer.GetNumBits();
+	MYNET_INC_COUNTER(STAT_MyNet_MoveBitsSent, MoveBitsSent, (int32)Writer.GetNumBits());
+
+	MyNetCharacter->ServerMovePacked(Packet);
+}
+
+void UMyNetCharacterMovementComponent::ServerMovePacked(const FMyNetMovePacket& Packet)
+{
+	if (Packet.bDual)
+	{
+		// Same as ServerMoveDual, the location of the pending move isn't checked
+		ServerMove_Implementation(Packet.PendingTimeStamp, DequantizeAcceleration(Packet.PendingAccelCode, Packet.PendingFullAccel), FVector(1.f, 2.f, 3.f),
+			Packet.PendingMoveFlags, Packet.ClientRoll, Packet.PendingView, Packet.ClientMovementBase, Packet.ClientBaseBoneName, Packet.ClientMovementMode);
+	}
+
+	ServerMove_Implementation(Packet.TimeStamp, DequantizeAcceleration(Packet.AccelCode, Packet.FullAccel), Packet.ClientLoc,
+		Packet.MoveFlags, Packet.ClientRoll, Packet.View, Packet.ClientMovementBase, Packet.ClientBaseBoneName, Packet.ClientMovementMode);
+}
+
+void UMyNetCharacterMovementComponent::ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	NumCorrections++;
+	MYNET_INC_COUNTER(STAT_MyNet_MoveCorrections, MoveCorrections, 1);
+
+	Super::ClientAdjustPosition_Implementation(TimeStamp, NewLoc, NewVel, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+}
+
+// ---------------- Console commands
+// -----------------------------
+
+static FAutoConsoleCommandWithArgs MoveBandwidthCmd(
+	TEXT("mynet.MoveBandwidth"),
+	TEXT("mynet.MoveBandwidth [PacketsPerSecond=30] [NumClients=64]. Compares the bits of a dual walking move, packed against ServerMoveDual"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 PacketsPerSecond = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 30, 1);
+		const int32 NumClients = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 64, 1);
+
+		const UMyNetCharacterMovementComponent* MovementComponent = GetDefault<UMyNetCharacterMovementComponent>();
+
+		// Two moves of a character running diagonally while turning a little, no movement base
+		const FVector Accel = MovementComponent->RoundAcceleration(FVector(0.8f, 0.6f, 0.f) * MovementComponent->MaxAcceleration);
+		const FVector ClientLoc(1234.56f, -789.01f, 230.15f);
+		const uint32 View = UCharacterMovementComponent::PackYawAndPitchTo32(37.5f, -12.f);
+		const uint32 PendingView = UCharacterMovementComponent::PackYawAndPitchTo32(36.8f, -12.2f);
+
+		FMyNetMovePacket Packet;
+		Packet.TimeStamp = 12.345f;
+		Packet.AccelCode = MovementComponent->QuantizeAcceleration(Accel);
+		Packet.View = View;
+		Packet.bDual = true;
+		Packet.PendingTimeStamp = 12.328f;
+		Packet.PendingAccelCode = Packet.AccelCode;
+		Packet.PendingView = PendingView;
+		Packet.ClientLoc = ClientLoc;
+		Packet.ClientMovementMode = MOVE_Walking;
+
+		FNetBitWriter PackedWriter(nullptr, 512);
+		bool bSuccess = true;
+		Packet.NetSerialize(PackedWriter, nullptr, bSuccess);
+
+		// The parameters of ServerMoveDual, in the same order
+		FNetBitWriter StockWriter(nullptr, 1024);
+		float TimeStamp = Packet.TimeStamp;
+		float PendingTimeStamp = Packet.PendingTimeStamp;
+		uint8 MoveFlags = 0;
+		uint8 ClientRoll = 0;
+		uint8 MovementMode = MOVE_Walking;
+		uint32 StockView = View;
+		uint32 StockPendingView = PendingView;
+		FName BoneName = NAME_None;
+		FVector_NetQuantize10 NetAccel(Accel);
+		FVector_NetQuantize100 NetClientLoc(ClientLoc);
+
+		StockWriter << PendingTimeStamp;
+		NetAccel.NetSerialize(StockWriter, nullptr, bSuccess);
+		StockWriter << MoveFlags << StockPendingView << TimeStamp;
+		NetAccel.NetSerialize(StockWriter, nullptr, bSuccess);
+		NetClientLoc.NetSerialize(StockWriter, nullptr, bSuccess);
+		StockWriter << MoveFlags << ClientRoll << StockView;
+		UPackageMap::StaticSerializeName(StockWriter, BoneName);
+		StockWriter << MovementMode;
+
+		const int64 PackedBits = PackedWriter.GetNumBits();
+		const int64 StockBits = StockWriter.GetNumBits();
+
+		UE_LOG(LogMyNet, Log, TEXT("mynet.MoveBandwidth: per dual move packet, packed %lld bits, ServerMoveDual %lld bits (%.0f%% saved)"),
+			PackedBits, StockBits, 100.0 * (StockBits - PackedBits) / StockBits);
+		UE_LOG(LogMyNet, Log, TEXT("  %d packets per second: packed %lld bytes/s, stock %lld bytes/s per client, server ingress for %d clients: packed %lld bytes/s, stock %lld bytes/s"),
+			PacketsPerSecond, PackedBits * PacketsPerSecond / 8, StockBits * PacketsPerSecond / 8,
+			NumClients, PackedBits * PacketsPerSecond * NumClients / 8, StockBits * PacketsPerSecond * NumClients / 8);
+	}));
+
+static FAutoConsoleCommandWithWorld MoveStatsCmd(
+	TEXT("mynet.MoveStats"),
+	TEXT("Logs the packed moves sent and the corrections received by the local characters. Compare the correction rate with mynet.PackedMoves off"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AMyNetCharacter> It(World); It; ++It)
+		{
+			const UMyNetCharacterMovementComponent* MovementComponent = Cast<UMyNetCharacterMovementComponent>(It->GetCharacterMovement());
+			if (!MovementComponent || !It->IsLocallyControlled())
+			{
+				continue;
+			}
+
+			UE_LOG(LogMyNet, Log, TEXT("mynet.MoveStats: %s packed %s, %d packets, %.1f bits per packet, %d corrections (%.2f%% of packets)"),
+				*It->GetName(), MovementComponent->bUsePackedMoves ? TEXT("on") : TEXT("off"), MovementComponent->NumPacketsSent,
+				MovementComponent->NumPacketsSent > 0 ? (double)MovementComponent->NumBitsSent / MovementComponent->NumPacketsSent : 0.0,
+				MovementComponent->NumCorrections,
+				MovementComponent->NumPacketsSent > 0 ? 100.0 * MovementComponent->NumCorrections / MovementComponent->NumPacketsSent : 0.0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs PackedMovesCmd(
+	TEXT("mynet.PackedMoves"),
+	TEXT("mynet.PackedMoves [0|1]. Switches the local characters between packed moves and the stock move RPCs and resets their mynet.MoveStats counters"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const bool bEnabled = Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0;
+
+		for (TActorIterator<AMyNetCharacter> It(World); It; ++It)
+		{
+			UMyNetCharacterMovementComponent* MovementComponent = Cast<UMyNetCharacterMovementComponent>(It->GetCharacterMovement());
+			if (MovementComponent && It->IsLocallyControlled())
+			{
+				MovementComponent->bUsePackedMoves = bEnabled;
+				MovementComponent->NumPacketsSent = 0;
+				MovementComponent->NumBitsSent = 0;
+				MovementComponent->NumCorrections = 0;
+			}
+		}
+	}));
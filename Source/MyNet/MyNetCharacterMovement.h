@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "MyNetCharacterMovement.generated.h"
+
+/**
+* The moves of a client packed in one server RPC, replacing ServerMove and ServerMoveDual.
+* Acceleration is sent as a quantized direction and magnitude, see UMyNetCharacterMovementComponent::QuantizeAcceleration,
+* and the view of the pending move as a delta to the view of the new one.
+*/
+USTRUCT()
+struct FMyNetMovePacket
+{
+	GENERATED_BODY()
+
+	/** Marks an acceleration that didn't fit the packed form and is sent in FullAccel */
+	static const uint32 FullAccelCode = 1 + (255 << 6 | 63) + 1;
+
+	/** Largest per axis view change sent as a delta, in the 16 bit units of the packed view */
+	static const int32 MaxViewDelta = 127;
+
+	float TimeStamp = 0.f;
+	uint16 AccelCode = 0;
+	FVector FullAccel = FVector::ZeroVector;
+	uint8 MoveFlags = 0;
+	uint32 View = 0;
+
+	/** True if a pending move was combined into the packet, it gets applied first */
+	bool bDual = false;
+
+	float PendingTimeStamp = 0.f;
+	uint16 PendingAccelCode = 0;
+	FVector PendingFullAccel = FVector::ZeroVector;
+	uint8 PendingMoveFlags = 0;
+	uint32 PendingView = 0;
+
+	FVector ClientLoc = FVector::ZeroVector;
+	uint8 ClientRoll = 0;
+	UPrimitiveComponent* ClientMovementBase = nullptr;
+	FName ClientBaseBoneName = NAME_None;
+	uint8 ClientMovementMode = 0;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FMyNetMovePacket> : public TStructOpsTypeTraitsBase2<FMyNetMovePacket>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Saved move that keeps the quantized acceleration, so moves only combine when the sent input is the same */
+class FSavedMove_MyNet : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+
+	/** Acceleration as sent, see UMyNetCharacterMovementComponent::QuantizeAcceleration */
+	uint16 AccelCode = 0;
+};
+
+class FNetworkPredictionData_Client_MyNet : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_MyNet(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/**
+* Character movement that sends the moves of the owning client as one bit packed RPC, see FMyNetMovePacket.
+* The acceleration gets rounded to the packed precision before it's simulated, so client and server
+* still run the exact same moves and the correction rate doesn't change. See mynet.MoveBandwidth.
+*/
+UCLASS(config=Game)
+class UMyNetCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Sends the moves as FMyNetMovePacket, the stock RPCs otherwise */
+	UPROPERTY(EditAnywhere, Config, Category = "Character Movement (Networking)")
+	bool bUsePackedMoves = true;
+
+	/**
+	* Packs a horizontal acceleration in 14 bits: 8 of direction, 6 of magnitude relative to MaxAcceleration.
+	* 0 is no acceleration, FMyNetMovePacket::FullAccelCode one that has to be sent as it is.
+	*/
+	uint16 QuantizeAcceleration(const FVector& Accel) const;
+
+	/** Reverse of QuantizeAcceleration, returns FullAccel for FMyNetMovePacket::FullAccelCode */
+	FVector DequantizeAcceleration(uint16 AccelCode, const FVector& FullAccel) const;
+
+	/** Runs the moves of a packet received from the owning client */
+	void ServerMovePacked(const FMyNetMovePacket& Packet);
+
+	/** Moves sent and corrections received by this client, for mynet.MoveStats */
+	int32 NumPacketsSent = 0;
+	int64 NumBitsSent = 0;
+	int32 NumCorrections = 0;
+
+	// UCharacterMovementComponent interface
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+	// End of UCharacterMovementComponent interface
+
+protected:
+	// UCharacterMovementComponent interface
+	virtual void CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove) override;
+	// End of UCharacterMovementComponent interface
+};
@@ -2,14 +2,187 @@
 
 #include "MyNetGameMode.h"
 #include "MyNetCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "BombPool.h"
+#include "LightBombManager.h"
+#include "ExplosionManager.h"
+#include "BombScheduler.h"
+#include "BombIntegrator.h"
+#include "CosmeticEventManager.h"
+#include "DamageAccumulator.h"
+#include "LoadTestRecorder.h"
+#include "ActorSignificanceManager.h"
+#include "StartupPreloader.h"
+#include "MatchManager.h"
+#include "MatchEventLog.h"
+#include "ServerTickManager.h"
+#include "MyNetPlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "GameFramework/GameSession.h"
+#include "EngineUtils.h"
+#include "Misc/CommandLine.h"
 
 AMyNetGameMode::AMyNetGameMode()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// The Blueprinted character gets streamed in by the startup preloader, which then sets it as the default pawn class
+	DefaultPawnClass = AMyNetCharacter::StaticClass();
+
+	// Receives the cosmetic event bundles
+	PlayerControllerClass = AMyNetPlayerController::StaticClass();
+}
+
+void AMyNetGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = this;
+	SpawnParameters.Instigator = Instigator;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	BombPool = GetWorld()->SpawnActor<ABombPool>(SpawnParameters);
+	LightBombManager = GetWorld()->SpawnActor<ALightBombManager>(SpawnParameters);
+	ExplosionManager = GetWorld()->SpawnActor<AExplosionManager>(SpawnParameters);
+	BombScheduler = GetWorld()->SpawnActor<ABombScheduler>(SpawnParameters);
+	BombIntegrator = GetWorld()->SpawnActor<ABombIntegrator>(SpawnParameters);
+	CosmeticEventManager = GetWorld()->SpawnActor<ACosmeticEventManager>(SpawnParameters);
+	DamageAccumulator = GetWorld()->SpawnActor<ADamageAccumulator>(SpawnParameters);
+	SignificanceManager = GetWorld()->SpawnActor<AActorSignificanceManager>(SpawnParameters);
+
+	// Started right away, so the streaming overlaps the rest of the map startup
+	StartupPreloader = GetWorld()->SpawnActor<AStartupPreloader>(SpawnParameters);
+	if (StartupPreloader)
+	{
+		StartupPreloader->Start();
+	}
+
+	// Before any player logs in, they are put in a match first thing
+	MatchManager = GetWorld()->SpawnActor<AMatchManager>(SpawnParameters);
+	if (MatchManager)
+	{
+		MatchManager->Init();
+	}
+
+	// Set with -EventLog, replayed by UReplayEventLogCommandlet
+	if (AMatchEventRecorder::IsRequested())
+	{
+		EventRecorder = GetWorld()->SpawnActor<AMatchEventRecorder>(SpawnParameters);
+	}
+
+	// Set with -FixedStep, a listen server keeps the frame rate of its player
+	if (AServerTickManager::IsRequested() && GetNetMode() == NM_DedicatedServer)
+	{
+		ServerTickManager = GetWorld()->SpawnActor<AServerTickManager>(SpawnParameters);
+	}
+
+	// Started by UBotLoadTestCommandlet
+	if (FParse::Param(FCommandLine::Get(), TEXT("LoadTest")))
+	{
+		LoadTestRecorder = GetWorld()->SpawnActor<ALoadTestRecorder>(SpawnParameters);
+	}
+}
+
+bool AMyNetGameMode::PlayerCanRestart_Implementation(APlayerController* Player)
+{
+	if (StartupPreloader && !StartupPreloader->IsReady())
+	{
+		return false;
+	}
+
+	// The arena of the match may still be streaming in
+	if (MatchManager && !MatchManager->IsMatchReady(Player))
+	{
+		return false;
+	}
+
+	return Super::PlayerCanRestart_Implementation(Player);
+}
+
+void AMyNetGameMode::OnStartupReady()
+{
+	if (UClass* PawnClass = StartupPreloader ? StartupPreloader->GetPawnClass() : nullptr)
+	{
+		DefaultPawnClass = PawnClass;
+	}
+
+	// The players that logged in during the preloading were left without a pawn
+	RestartWaitingPlayers();
+}
+
+void AMyNetGameMode::RestartWaitingPlayers()
+{
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController && !PlayerController->GetPawn() && !bStartPlayersAsSpectators && !MustSpectate(PlayerController) && PlayerCanRestart(PlayerController))
+		{
+			RestartPlayer(PlayerController);
+		}
+	}
+}
+
+void AMyNetGameMode::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+
+	if (ErrorMessage.IsEmpty() && MatchManager && MatchManager->IsFull())
+	{
+		ErrorMessage = TEXT("Every match is full");
+	}
+}
+
+void AMyNetGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	const int32 MatchId = MatchManager ? MatchManager->AddPlayer(NewPlayer) : 0;
+
+	Super::PostLogin(NewPlayer);
+
+	// Logged in while the last seats were taken, the player got no pawn
+	if (MatchId == INDEX_NONE && GameSession)
+	{
+		GameSession->KickPlayer(NewPlayer, FText::FromString(TEXT("Every match is full")));
+	}
+}
+
+void AMyNetGameMode::Logout(AController* Exiting)
+{
+	if (MatchManager)
+	{
+		MatchManager->RemovePlayer(Exiting);
+	}
+
+	Super::Logout(Exiting);
+}
+
+AActor* AMyNetGameMode::ChoosePlayerStart_Implementation(AController* Player)
+{
+	const AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(Player);
+	ULevel* MatchLevel = MatchManager && MatchManager->IsEnabled() && PlayerController ? MatchManager->GetMatchLevel(PlayerController->GetMatchId()) : nullptr;
+	if (!MatchLevel)
+	{
+		return Super::ChoosePlayerStart_Implementation(Player);
+	}
+
+	// Every arena brings its own starts
+	TArray<APlayerStart*> PlayerStarts;
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+	{
+		if (It->GetLevel() == MatchLevel)
+		{
+			PlayerStarts.Add(*It);
+		}
+	}
+
+	return PlayerStarts.Num() > 0 ? PlayerStarts[FMath::RandHelper(PlayerStarts.Num())] : Super::ChoosePlayerStart_Implementation(Player);
+}
+
+void AMyNetGameMode::SetPlayerDefaults(APawn* PlayerPawn)
+{
+	Super::SetPlayerDefaults(PlayerPawn);
+
+	AMyNetCharacter* Character = Cast<AMyNetCharacter>(PlayerPawn);
+	const AMyNetPlayerController* PlayerController = Character ? Cast<AMyNetPlayerController>(Character->GetController()) : nullptr;
+	if (PlayerController)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		Character->SetMatchId(PlayerController->GetMatchId());
 	}
 }
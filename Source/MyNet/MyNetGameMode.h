@@ -6,6 +6,20 @@
 #include "GameFramework/GameModeBase.h"
 #include "MyNetGameMode.generated.h"
 
+class ABombPool;
+class ALightBombManager;
+class AExplosionManager;
+class ABombScheduler;
+class ABombIntegrator;
+class ACosmeticEventManager;
+class ADamageAccumulator;
+class ALoadTestRecorder;
+class AActorSignificanceManager;
+class AStartupPreloader;
+class AMatchManager;
+class AMatchEventRecorder;
+class AServerTickManager;
+
 UCLASS(minimalapi)
 class AMyNetGameMode : public AGameModeBase
 {
@@ -13,6 +27,123 @@ class AMyNetGameMode : public AGameModeBase
 
 public:
 	AMyNetGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	/** Players only get a pawn once the startup preloading is done */
+	virtual bool PlayerCanRestart_Implementation(APlayerController* Player) override;
+
+	/** Called by the startup preloader when it's done. Sets the pawn class and spawns the players that waited */
+	void OnStartupReady();
+
+	/** Spawns the players left without a pawn, now that they can restart */
+	void RestartWaitingPlayers();
+
+	/** Turns players away once every match is full */
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override;
+
+	/** Puts the new player in a match before the engine spawns its pawn */
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+
+	virtual void Logout(AController* Exiting) override;
+
+	/** Picks a player start of the arena of the match of the player */
+	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
+
+	/** Tags the character with the match of its player */
+	virtual void SetPlayerDefaults(APawn* PlayerPawn) override;
+
+	/** Returns the server side bomb pool */
+	FORCEINLINE ABombPool* GetBombPool() const { return BombPool; }
+
+	/** Returns the manager of the actorless bombs */
+	FORCEINLINE ALightBombManager* GetLightBombManager() const { return LightBombManager; }
+
+	/** Returns the manager that resolves the explosions */
+	FORCEINLINE AExplosionManager* GetExplosionManager() const { return ExplosionManager; }
+
+	/** Returns the scheduler driving the bomb fuses */
+	FORCEINLINE ABombScheduler* GetBombScheduler() const { return BombScheduler; }
+
+	/** Returns the batched flight simulation of the bombs */
+	FORCEINLINE ABombIntegrator* GetBombIntegrator() const { return BombIntegrator; }
+
+	/** Returns the manager bundling the cosmetic events */
+	FORCEINLINE ACosmeticEventManager* GetCosmeticEventManager() const { return CosmeticEventManager; }
+
+	/** Returns the collector of the damage of a frame */
+	FORCEINLINE ADamageAccumulator* GetDamageAccumulator() const { return DamageAccumulator; }
+
+	/** Returns the recorder of the load test, null unless the server runs with -LoadTest */
+	FORCEINLINE ALoadTestRecorder* GetLoadTestRecorder() const { return LoadTestRecorder; }
+
+	/** Returns the throttling of the far away characters and bombs */
+	FORCEINLINE AActorSignificanceManager* GetSignificanceManager() const { return SignificanceManager; }
+
+	/** Returns the loading and warming up of the bomb assets */
+	FORCEINLINE AStartupPreloader* GetStartupPreloader() const { return StartupPreloader; }
+
+	/** Returns the matches hosted by this process */
+	FORCEINLINE AMatchManager* GetMatchManager() const { return MatchManager; }
+
+	/** Returns the recorder of the match event log, null unless the server records one */
+	FORCEINLINE AMatchEventRecorder* GetEventRecorder() const { return EventRecorder; }
+
+	/** Returns the fixed step pacing of the server, null unless the dedicated server runs in fixed steps */
+	FORCEINLINE AServerTickManager* GetServerTickManager() const { return ServerTickManager; }
+
+private:
+	/** Pool used to recycle the thrown bombs */
+	UPROPERTY(Transient)
+	ABombPool* BombPool;
+
+	/** Simulates and replicates the bombs thrown in container mode */
+	UPROPERTY(Transient)
+	ALightBombManager* LightBombManager;
+
+	/** Resolves the explosions of a frame in one go */
+	UPROPERTY(Transient)
+	AExplosionManager* ExplosionManager;
+
+	/** Timer wheel for the fuse and cleanup of every bomb */
+	UPROPERTY(Transient)
+	ABombScheduler* BombScheduler;
+
+	/** Flies the bombs in batches instead of one component tick each */
+	UPROPERTY(Transient)
+	ABombIntegrator* BombIntegrator;
+
+	/** Sends the explosion effects to the players around them */
+	UPROPERTY(Transient)
+	ACosmeticEventManager* CosmeticEventManager;
+
+	/** Applies the damage of a frame once per victim */
+	UPROPERTY(Transient)
+	ADamageAccumulator* DamageAccumulator;
+
+	/** Records the load test runs */
+	UPROPERTY(Transient)
+	ALoadTestRecorder* LoadTestRecorder;
+
+	/** Throttles the ticks and net updates of the far away actors */
+	UPROPERTY(Transient)
+	AActorSignificanceManager* SignificanceManager;
+
+	/** Streams and warms up the pawn and bomb assets before the players get in */
+	UPROPERTY(Transient)
+	AStartupPreloader* StartupPreloader;
+
+	/** Hosts several matches in this process */
+	UPROPERTY(Transient)
+	AMatchManager* MatchManager;
+
+	/** Writes the gameplay events to a log for offline replays */
+	UPROPERTY(Transient)
+	AMatchEventRecorder* EventRecorder;
+
+	/** Paces the fixed steps of the server and its replication */
+	UPROPERTY(Transient)
+	AServerTickManager* ServerTickManager;
 };
 
 
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MyNetIpNetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ChildConnection.h"
+#include "GameFramework/PlayerController.h"
+
+#if WITH_SERVER_CODE
+int32 UMyNetIpNetDriver::ServerReplicateActors(float DeltaSeconds)
+{
+	TimeSinceReplication += DeltaSeconds;
+
+	// Small slack, so an interval the frame time divides doesn't lose a frame to rounding
+	if (TimeSinceReplication + KINDA_SMALL_NUMBER < ReplicationInterval)
+	{
+		SendClientAdjustments();
+		return 0;
+	}
+
+	const float ReplicationDeltaSeconds = TimeSinceReplication;
+
+	// The remainder carries over, so an interval the frame time doesn't divide still averages out
+	TimeSinceReplication = ReplicationInterval > 0.f ? FMath::Fmod(TimeSinceReplication, ReplicationInterval) : 0.f;
+	if (TimeSinceReplication + KINDA_SMALL_NUMBER >= ReplicationInterval)
+	{
+		TimeSinceReplication = 0.f;
+	}
+
+	NumReplicationPasses++;
+
+	return Super::ServerReplicateActors(ReplicationDeltaSeconds);
+}
+
+void UMyNetIpNetDriver::SendClientAdjustments()
+{
+	// Same as ServerReplicateActors_PrepConnections, so a client's moves are acked or corrected at the frame rate, not the replication rate
+	for (UNetConnection* Connection : ClientConnections)
+	{
+		if (!Connection || Connection->State == USOCK_Closed || !Connection->ViewTarget)
+		{
+			continue;
+		}
+
+		if (APlayerController* PlayerController = Connection->PlayerController)
+		{
+			PlayerController->SendClientAdjustment();
+		}
+
+		for (UChildConnection* Child : Connection->Children)
+		{
+			if (Child && Child->PlayerController)
+			{
+				Child->PlayerController->SendClientAdjustment();
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IpNetDriver.h"
+#include "MyNetIpNetDriver.generated.h"
+
+/**
+* The game net driver of the project, see NetDriverDefinitions in DefaultEngine.ini.
+* Lets the server replicate at its own rate instead of every frame: the connections are still read and
+* flushed each frame, so the moves and RPCs of the clients get in as fast as before, only the actor
+* replication passes are spaced out. The move acks and corrections the pass would have sent go out every
+* frame regardless, see SendClientAdjustments. Set by AServerTickManager, replicates every frame otherwise.
+*/
+UCLASS(transient, config=Engine)
+class MYNET_API UMyNetIpNetDriver : public UIpNetDriver
+{
+	GENERATED_BODY()
+
+public:
+#if WITH_SERVER_CODE
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+#endif
+
+	/** Sets the seconds between two replication passes, 0 for every frame */
+	void SetReplicationInterval(float Interval) { ReplicationInterval = FMath::Max(Interval, 0.f); }
+
+	/** Returns the replication passes run so far */
+	int32 GetNumReplicationPasses() const { return NumReplicationPasses; }
+
+private:
+#if WITH_SERVER_CODE
+	/** What the skipped pass would have sent the player controllers of every connection, move acks and corrections */
+	void SendClientAdjustments();
+#endif
+
+	float ReplicationInterval = 0.f;
+
+	/** Time not replicated yet, the passes get the whole of it */
+	float TimeSinceReplication = 0.f;
+
+	int32 NumReplicationPasses = 0;
+};
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MyNetPlayerController.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "ActorSignificanceManager.h"
+#include "StartupPreloader.h"
+#include "MatchManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+
+// ---------------- Cosmetic events
+// -----------------------------
+
+void AMyNetPlayerController::ClientReceiveCosmeticEvents_Implementation(const TArray<FCosmeticEvent>& Events)
+{
+	for (const FCosmeticEvent& Event : Events)
+	{
+		switch (Event.Type)
+		{
+		case ECosmeticEventType::Explosion:
+			if (Event.Effect)
+			{
+				FStartupCostScope StartupCostScope(GetWorld(), EStartupCost::ExplosionFX);
+				UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Event.Effect, FTransform(Event.Location), true);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// ---------------- RPC budget
+// -----------------------------
+
+void AMyNetPlayerController::GetRpcBudget(ERpcBudget Rpc, float& OutRate, float& OutBurst) const
+{
+	switch (Rpc)
+	{
+	case ERpcBudget::SpawnBomb:
+		OutRate = SpawnBombRate;
+		OutBurst = SpawnBombBurst;
+		break;
+
+	case ERpcBudget::TakeDamage:
+	default:
+		OutRate = TakeDamageRate;
+		OutBurst = TakeDamageBurst;
+		break;
+	}
+}
+
+bool AMyNetPlayerController::ConsumeRpcBudget(ERpcBudget Rpc)
+{
+	float Rate, Burst;
+	GetRpcBudget(Rpc, Rate, Burst);
+
+	return RpcBuckets[(int32)Rpc].TryConsume(GetWorld()->GetTimeSeconds(), Rate, Burst);
+}
+
+float AMyNetPlayerController::GetRpcBudgetDelay(ERpcBudget Rpc) const
+{
+	float Rate, Burst;
+	GetRpcBudget(Rpc, Rate, Burst);
+
+	return RpcBuckets[(int32)Rpc].GetTimeToNextToken(GetWorld()->GetTimeSeconds(), Rate);
+}
+
+void AMyNetPlayerController::LogRpcBudget() const
+{
+	static const TCHAR* RpcNames[] = { TEXT("ServerSpawnBomb"), TEXT("ServerTakeDamage") };
+	static_assert(ARRAY_COUNT(RpcNames) == (int32)ERpcBudget::Num, "Name every budgeted RPC");
+
+	for (int32 Index = 0; Index < (int32)ERpcBudget::Num; Index++)
+	{
+		const FRpcTokenBucket& Bucket = RpcBuckets[Index];
+		UE_LOG(LogMyNet, Log, TEXT("%s %s: %d accepted, %d rejected, %d coalesced"),
+			*GetName(), RpcNames[Index], Bucket.NumAccepted, Bucket.NumRejected, Bucket.NumCoalesced);
+	}
+}
+
+static FAutoConsoleCommandWithWorld RpcBudgetStatsCmd(
+	TEXT("mynet.RpcBudgetStats"),
+	TEXT("Logs the server RPC budget counters of every connection"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			if (const AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(It->Get()))
+			{
+				PlayerController->LogRpcBudget();
+			}
+		}
+	}));
+
+// ---------------- Matches
+// -----------------------------
+
+void AMyNetPlayerController::ClientEnterMatch_Implementation(int32 InMatchId, FVector Origin)
+{
+	MatchId = InMatchId;
+
+	// The first match plays in the map the client already has, the listen server host has every arena
+	if (GetNetMode() != NM_Client || InMatchId <= 0)
+	{
+		return;
+	}
+
+	// Under the package name the server gave it
+	const FString& ArenaMap = GetDefault<AMatchManager>()->GetArenaMap();
+	if (!AMatchManager::LoadArena(GetWorld(), ArenaMap, InMatchId, Origin))
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Couldn't stream in the arena %s of match %d"), *ArenaMap, MatchId);
+	}
+}
+
+// ---------------- Bots
+// -----------------------------
+
+void AMyNetPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Clients throttle the far away actors for their own view
+	if (IsLocalController() && GetNetMode() == NM_Client)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.Owner = this;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		ClientSignificanceManager = GetWorld()->SpawnActor<AActorSignificanceManager>(SpawnParameters);
+
+		// Streams and warms up the bomb visuals before the first throw needs them
+		ClientStartupPreloader = GetWorld()->SpawnActor<AStartupPreloader>(SpawnParameters);
+		if (ClientStartupPreloader)
+		{
+			ClientStartupPreloader->Start();
+		}
+	}
+
+	// Load test clients play by themselves from the start
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (IsLocalController() && FParse::Param(CommandLine, TEXT("BotClient")))
+	{
+		int32 Seed = 0;
+		FParse::Value(CommandLine, TEXT("BotSeed="), Seed);
+		BotRandom.Initialize(Seed);
+
+		FString Pattern;
+		bScriptedBot = FParse::Value(CommandLine, TEXT("BotPattern="), Pattern) && Pattern == TEXT("Circle");
+
+		SetBotEnabled(true);
+	}
+}
+
+void AMyNetPlayerController::SetBotEnabled(bool bEnabled)
+{
+	bIsBot = bEnabled;
+	BotTime = 0.f;
+	NextBotDirectionTime = 0.f;
+	NextBotThrowTime = BotRandom.FRandRange(0.f, BotThrowInterval);
+}
+
+void AMyNetPlayerController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	if (bIsBot)
+	{
+		DriveBot(DeltaTime);
+	}
+}
+
+void AMyNetPlayerController::DriveBot(float DeltaTime)
+{
+	AMyNetCharacter* MyNetCharacter = Cast<AMyNetCharacter>(GetPawn());
+	if (!MyNetCharacter)
+	{
+		return;
+	}
+
+	BotTime += DeltaTime;
+
+	if (bScriptedBot)
+	{
+		// Full speed ahead while turning, the same every run
+		BotForward = 1.f;
+		BotRight = FMath::Sin(BotTime);
+		bBotJump = false;
+	}
+	else if (BotTime >= NextBotDirectionTime)
+	{
+		BotForward = (float)BotRandom.RandRange(-1, 1);
+		BotRight = (float)BotRandom.RandRange(-1, 1);
+		bBotJump = BotRandom.FRand() < BotJumpChance;
+		NextBotDirectionTime = BotTime + BotRandom.FRandRange(0.5f, 1.5f) * BotDirectionInterval;
+	}
+
+	bool bThrowBomb = false;
+	if (BotTime >= NextBotThrowTime)
+	{
+		bThrowBomb = true;
+		NextBotThrowTime = BotTime + BotRandom.FRandRange(0.5f, 1.5f) * BotThrowInterval;
+	}
+
+	MyNetCharacter->ApplyBotInput(BotForward, BotRight, bBotJump, bThrowBomb);
+	bBotJump = false;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BotCmd(
+	TEXT("mynet.Bot"),
+	TEXT("mynet.Bot [0|1]. Lets the local player play by itself, the way the load test clients do"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const bool bEnabled = Args.Num() == 0 || FCString::Atoi(*Args[0]) != 0;
+
+		if (AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(World->GetFirstPlayerController()))
+		{
+			PlayerController->SetBotEnabled(bEnabled);
+		}
+	}));
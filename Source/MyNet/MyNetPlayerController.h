@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "CosmeticEventManager.h"
+#include "RpcBudget.h"
+#include "MyNetPlayerController.generated.h"
+
+UCLASS(config=Game)
+class MYNET_API AMyNetPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+// ---------------- Cosmetic events
+// -----------------------------
+public:
+	/**
+	* Receives the cosmetic events of a net tick around this player, all in one bundle.
+	* Unreliable, a lost bundle only means a few missing particles.
+	*/
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveCosmeticEvents(const TArray<FCosmeticEvent>& Events);
+
+	/** Contains the actual implementation of the ClientReceiveCosmeticEvents function */
+	void ClientReceiveCosmeticEvents_Implementation(const TArray<FCosmeticEvent>& Events);
+
+// ---------------- RPC budget
+// -----------------------------
+public:
+	/**
+	* Takes a token from the budget of an RPC of this connection. Server only.
+	* Call it first thing in the RPC implementation and bail out on false.
+	*/
+	bool ConsumeRpcBudget(ERpcBudget Rpc);
+
+	/** Counts an over budget call that was dropped */
+	void RejectRpc(ERpcBudget Rpc) { RpcBuckets[(int32)Rpc].MarkRejected(); }
+
+	/** Counts an over budget call that was folded into a later one */
+	void CoalesceRpc(ERpcBudget Rpc) { RpcBuckets[(int32)Rpc].MarkCoalesced(); }
+
+	/** Seconds until the RPC fits in the budget again */
+	float GetRpcBudgetDelay(ERpcBudget Rpc) const;
+
+	/** Logs the accepted/rejected/coalesced counters of this connection */
+	void LogRpcBudget() const;
+
+	/** Returns the budget of an RPC, with its counters */
+	const FRpcTokenBucket& GetRpcBucket(ERpcBudget Rpc) const { return RpcBuckets[(int32)Rpc]; }
+
+protected:
+	/** ServerSpawnBomb calls allowed per second */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "RPC Budget")
+	float SpawnBombRate = 4.f;
+
+	/** ServerSpawnBomb calls allowed in a row */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "RPC Budget")
+	float SpawnBombBurst = 4.f;
+
+	/** ServerTakeDamage calls allowed per second */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "RPC Budget")
+	float TakeDamageRate = 10.f;
+
+	/** ServerTakeDamage calls allowed in a row */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "RPC Budget")
+	float TakeDamageBurst = 20.f;
+
+private:
+	/** Rate and burst of an RPC */
+	void GetRpcBudget(ERpcBudget Rpc, float& OutRate, float& OutBurst) const;
+
+	FRpcTokenBucket RpcBuckets[(int32)ERpcBudget::Num];
+
+// ---------------- Matches
+// -----------------------------
+public:
+	/** Returns the match of this player when the server hosts several */
+	int32 GetMatchId() const { return MatchId; }
+
+	/** Server only, see AMatchManager */
+	void SetMatchId(int32 InMatchId) { MatchId = InMatchId; }
+
+	/** Tells the client its match and where its arena is, so it streams in the same copy of the map */
+	UFUNCTION(Client, Reliable)
+	void ClientEnterMatch(int32 InMatchId, FVector Origin);
+
+	/** Contains the actual implementation of the ClientEnterMatch function */
+	void ClientEnterMatch_Implementation(int32 InMatchId, FVector Origin);
+
+private:
+	int32 MatchId = 0;
+
+// ---------------- Bots
+// -----------------------------
+public:
+	virtual void BeginPlay() override;
+
+	virtual void PlayerTick(float DeltaTime) override;
+
+	/** Starts or stops playing by itself */
+	void SetBotEnabled(bool bEnabled);
+
+protected:
+	/** Seconds a bot keeps going in a direction before picking another */
+	UPROPERTY(Config, EditDefaultsOnly, Category = Bots)
+	float BotDirectionInterval = 1.5f;
+
+	/** Average seconds between the bomb throws of a bot */
+	UPROPERTY(Config, EditDefaultsOnly, Category = Bots)
+	float BotThrowInterval = 3.f;
+
+	/** Chance of a jump whenever a bot picks a new direction */
+	UPROPERTY(Config, EditDefaultsOnly, Category = Bots)
+	float BotJumpChance = 0.2f;
+
+public:
+	/** Returns the startup preloader of a client, the server has its own in the game mode */
+	class AStartupPreloader* GetClientStartupPreloader() const { return ClientStartupPreloader; }
+
+private:
+	/** The startup preloader of a client */
+	UPROPERTY(Transient)
+	class AStartupPreloader* ClientStartupPreloader;
+
+	/** The significance throttling of a client, the server has its own in the game mode */
+	UPROPERTY(Transient)
+	class AActorSignificanceManager* ClientSignificanceManager;
+
+	/** Feeds the input of this frame to the character */
+	void DriveBot(float DeltaTime);
+
+	/** True if this controller plays by itself, for load tests. See -BotClient */
+	bool bIsBot = false;
+
+	/** Scripted bots run in circles, the others pick random directions. See -BotPattern */
+	bool bScriptedBot = false;
+
+	FRandomStream BotRandom;
+
+	float BotForward = 0.f;
+	float BotRight = 0.f;
+	bool bBotJump = false;
+
+	float BotTime = 0.f;
+	float NextBotDirectionTime = 0.f;
+	float NextBotThrowTime = 0.f;
+};
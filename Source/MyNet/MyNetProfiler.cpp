@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MyNetProfiler.h"
+#include "MyNet.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<int32> CVarStatsRing(
+	TEXT("mynet.StatsRing"),
+	1,
+	TEXT("Records the MyNet timers and counters of the last frames for mynet.StatsDump. 0 turns it off"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarStatsRingFrames(
+	TEXT("mynet.StatsRingFrames"),
+	600,
+	TEXT("Number of frames kept by mynet.StatsRing, read once at startup"),
+	ECVF_ReadOnly);
+
+static const TCHAR* TimerNames[] = { TEXT("SpawnBomb"), TEXT("Explode"), TEXT("RadialDamage"), TEXT("TakeDamage"), TEXT("UpdateCharText"), TEXT("RepNotify") };
+static_assert(ARRAY_COUNT(TimerNames) == (int32)EMyNetTimer::Num, "Name every timer");
+
+static const TCHAR* CounterNames[] = { TEXT("LiveBombs"), TEXT("ArmedBombs"), TEXT("SpawnBombRpcs"), TEXT("TakeDamageRpcs"), TEXT("StatsBitsSent"), TEXT("LightBombBitsSent"), TEXT("MoveBitsSent"), TEXT("MoveCorrections") };
+static_assert(ARRAY_COUNT(CounterNames) == (int32)EMyNetCounter::Num, "Name every counter");
+
+/** Levels carry over from frame to frame, the other counters start again at 0 */
+static bool IsLevelCounter(int32 Counter)
+{
+	return Counter == (int32)EMyNetCounter::LiveBombs || Counter == (int32)EMyNetCounter::ArmedBombs;
+}
+
+FMyNetFrameRecorder& FMyNetFrameRecorder::Get()
+{
+	static FMyNetFrameRecorder Recorder;
+	return Recorder;
+}
+
+bool FMyNetFrameRecorder::IsEnabled()
+{
+	return CVarStatsRing.GetValueOnGameThread() != 0;
+}
+
+FMyNetFrameRecorder::FMyNetFrameRecorder()
+{
+	Frames.SetNum(FMath::Max(CVarStatsRingFrames.GetValueOnGameThread(), 1));
+
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FMyNetFrameRecorder::EndFrame);
+}
+
+void FMyNetFrameRecorder::EndFrame()
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	Current.FrameNumber = GFrameCounter;
+	Current.DeltaTime = FApp::GetDeltaTime();
+
+	Frames[NextFrame] = Current;
+	NextFrame = (NextFrame + 1) % Frames.Num();
+	NumRecorded = FMath::Min(NumRecorded + 1, Frames.Num());
+
+	FMemory::Memzero(Current.Cycles);
+	for (int32 Counter = 0; Counter < (int32)EMyNetCounter::Num; Counter++)
+	{
+		if (!IsLevelCounter(Counter))
+		{
+			Current.Counts[Counter] = 0;
+		}
+	}
+}
+
+void FMyNetFrameRecorder::Dump(int32 NumFrames, const FString& CsvPath) const
+{
+	NumFrames = FMath::Clamp(NumFrames, 0, NumRecorded);
+	if (NumFrames == 0)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("mynet.StatsDump: nothing recorded"));
+		return;
+	}
+
+	UE_LOG(LogMyNet, Log, TEXT("mynet.StatsDump: last %d frames"), NumFrames);
+
+	for (int32 Timer = 0; Timer < (int32)EMyNetTimer::Num; Timer++)
+	{
+		double SumMs = 0.0, MaxMs = 0.0;
+		for (int32 Age = 0; Age < NumFrames; Age++)
+		{
+			const double Ms = FPlatformTime::ToMilliseconds(GetFrame(Age).Cycles[Timer]);
+			SumMs += Ms;
+			MaxMs = FMath::Max(MaxMs, Ms);
+		}
+		UE_LOG(LogMyNet, Log, TEXT("  %-18s avg %8.3f ms, max %8.3f ms"), TimerNames[Timer], SumMs / NumFrames, MaxMs);
+	}
+
+	for (int32 Counter = 0; Counter < (int32)EMyNetCounter::Num; Counter++)
+	{
+		int64 Sum = 0;
+		int32 Max = 0;
+		for (int32 Age = 0; Age < NumFrames; Age++)
+		{
+			const int32 Count = GetFrame(Age).Counts[Counter];
+			Sum += Count;
+			Max = FMath::Max(Max, Count);
+		}
+		UE_LOG(LogMyNet, Log, TEXT("  %-18s avg %8.1f, max %6d"), CounterNames[Counter], (double)Sum / NumFrames, Max);
+	}
+
+	if (CsvPath.IsEmpty())
+	{
+		return;
+	}
+
+	// Oldest frame first
+	FString Csv = TEXT("Frame,DeltaMs");
+	for (const TCHAR* Name : TimerNames)
+	{
+		Csv += FString::Printf(TEXT(",%sMs"), Name);
+	}
+	for (const TCHAR* Name : CounterNames)
+	{
+		Csv += FString::Printf(TEXT(",%s"), Name);
+	}
+	Csv += TEXT("\n");
+
+	for (int32 Age = NumFrames - 1; Age >= 0; Age--)
+	{
+		const FFrame& Frame = GetFrame(Age);
+		Csv += FString::Printf(TEXT("%llu,%.3f"), Frame.FrameNumber, Frame.DeltaTime * 1000.f);
+		for (uint32 Cycles : Frame.Cycles)
+		{
+			Csv += FString::Printf(TEXT(",%.4f"), FPlatformTime::ToMilliseconds(Cycles));
+		}
+		for (int32 Count : Frame.Counts)
+		{
+			Csv += FString::Printf(TEXT(",%d"), Count);
+		}
+		Csv += TEXT("\n");
+	}
+
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+	{
+		UE_LOG(LogMyNet, Log, TEXT("mynet.StatsDump: wrote %s"), *CsvPath);
+	}
+}
+
+static FAutoConsoleCommandWithArgs StatsDumpCmd(
+	TEXT("mynet.StatsDump"),
+	TEXT("mynet.StatsDump [Frames=600] [csv]. Logs the MyNet timers and counters of the last frames, csv also writes them to Saved/Profiling"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumFrames = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 600;
+
+		FString CsvPath;
+		if (Args.Contains(TEXT("csv")))
+		{
+			CsvPath = FPaths::ProfilingDir() / FString::Printf(TEXT("MyNetStats-%s.csv"), *FDateTime::Now().ToString());
+		}
+
+		FMyNetFrameRecorder::Get().Dump(NumFrames, CsvPath);
+	}));
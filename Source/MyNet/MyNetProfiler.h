@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+/** The hot paths timed by the frame recorder */
+enum class EMyNetTimer : uint8
+{
+	SpawnBomb,
+	Explode,
+	RadialDamage,
+	TakeDamage,
+	UpdateCharText,
+	RepNotify,
+
+	Num
+};
+
+/** The counts kept by the frame recorder. LiveBombs and ArmedBombs are levels, the others per frame sums */
+enum class EMyNetCounter : uint8
+{
+	LiveBombs,
+	ArmedBombs,
+	SpawnBombRpcs,
+	TakeDamageRpcs,
+	StatsBitsSent,
+	LightBombBitsSent,
+	MoveBitsSent,
+	MoveCorrections,
+
+	Num
+};
+
+/**
+* Ring buffer with the timers and counters of the last frames, cheap enough to always run on servers.
+* The stat group shows the same numbers live, this keeps them around so they can be dumped after the
+* fact with mynet.StatsDump, including from a server console. See mynet.StatsRing.
+* Game thread only.
+*/
+class MYNET_API FMyNetFrameRecorder
+{
+public:
+	static FMyNetFrameRecorder& Get();
+
+	/** False if mynet.StatsRing is 0 */
+	static bool IsEnabled();
+
+	void AddCycles(EMyNetTimer Timer, uint32 Cycles) { Current.Cycles[(int32)Timer] += Cycles; }
+
+	void AddCount(EMyNetCounter Counter, int32 Delta) { Current.Counts[(int32)Counter] += Delta; }
+
+	/**
+	* Logs the averages and maximums of the last frames.
+	* @param CsvPath	If not empty, also writes every frame there
+	*/
+	void Dump(int32 NumFrames, const FString& CsvPath) const;
+
+private:
+	FMyNetFrameRecorder();
+
+	/** Moves the current frame into the ring */
+	void EndFrame();
+
+	struct FFrame
+	{
+		uint64 FrameNumber = 0;
+		float DeltaTime = 0.f;
+		uint32 Cycles[(int32)EMyNetTimer::Num] = {};
+		int32 Counts[(int32)EMyNetCounter::Num] = {};
+	};
+
+	/** Returns the frame Age frames back, 0 being the last complete one */
+	const FFrame& GetFrame(int32 Age) const { return Frames[(NextFrame - 1 - Age + Frames.Num()) % Frames.Num()]; }
+
+	TArray<FFrame> Frames;
+	int32 NextFrame = 0;
+	int32 NumRecorded = 0;
+
+	FFrame Current;
+};
+
+/** Adds the time spent in its scope to a timer of the frame recorder */
+struct MYNET_API FMyNetTimerScope
+{
+	explicit FMyNetTimerScope(EMyNetTimer InTimer)
+		: Timer(InTimer)
+		, StartCycles(FMyNetFrameRecorder::IsEnabled() ? FPlatformTime::Cycles() : 0)
+	{
+	}
+
+	~FMyNetTimerScope()
+	{
+		if (StartCycles != 0)
+		{
+			FMyNetFrameRecorder::Get().AddCycles(Timer, FPlatformTime::Cycles() - StartCycles);
+		}
+	}
+
+private:
+	EMyNetTimer Timer;
+	uint32 StartCycles;
+};
+
+/** Times the scope in the MyNet stat group and in the frame recorder */
+#define MYNET_SCOPE_CYCLE_COUNTER(Stat, Timer) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	FMyNetTimerScope ANONYMOUS_VARIABLE(MyNetTimerScope)(EMyNetTimer::Timer)
+
+/** Adds to a counter of the MyNet stat group and of the frame recorder */
+#define MYNET_INC_COUNTER(Stat, Counter, Amount) \
+	INC_DWORD_STAT_BY(Stat, Amount); \
+	FMyNetFrameRecorder::Get().AddCount(EMyNetCounter::Counter, Amount)
+
+/** Removes from a level of the MyNet stat group and of the frame recorder */
+#define MYNET_DEC_COUNTER(Stat, Counter, Amount) \
+	DEC_DWORD_STAT_BY(Stat, Amount); \
+	FMyNetFrameRecorder::Get().AddCount(EMyNetCounter::Counter, -(Amount))
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ReplayEventLogCommandlet.h"
+#include "MyNet.h"
+#include "MyNetGameMode.h"
+#include "MyNetCharacter.h"
+#include "ExplosionManager.h"
+#include "DamageAccumulator.h"
+#include "StartupPreloader.h"
+#include "MatchEventLog.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+UReplayEventLogCommandlet::UReplayEventLogCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UReplayEventLogCommandlet::Main(const FString& Params)
+{
+	const TCHAR* ParamsStr = *Params;
+
+	FString Path;
+	int32 NumLoops = 3;
+	FParse::Value(ParamsStr, TEXT("Log="), Path);
+	FParse::Value(ParamsStr, TEXT("Loops="), NumLoops);
+	NumLoops = FMath::Max(NumLoops, 1);
+
+	FMatchEventReader Reader;
+	if (!Reader.Open(Path))
+	{
+		UE_LOG(LogMyNet, Error, TEXT("ReplayEventLog: %s isn't a match event log, pass one with -Log=Path"), *Path);
+		return 1;
+	}
+
+	// Decoded up front, so only the game code gets timed
+	TArray<FMatchEvent> Events;
+	int32 EventCounts[(int32)EMatchEvent::Num] = {};
+
+	FMatchEvent Event;
+	while (Reader.Next(Event))
+	{
+		EventCounts[(int32)Event.Type]++;
+		Events.Add(MoveTemp(Event));
+	}
+
+	const float RecordedSeconds = Events.Num() > 0 ? Events.Last().Time - Events[0].Time : 0.f;
+
+	UE_LOG(LogMyNet, Display, TEXT("ReplayEventLog: %s, %.1f seconds, %d frames, %d bomb spawns, %d bounces, %d explosions, %d damage applications"),
+		*Path, RecordedSeconds, EventCounts[(int32)EMatchEvent::Positions], EventCounts[(int32)EMatchEvent::BombSpawn],
+		EventCounts[(int32)EMatchEvent::Bounce], EventCounts[(int32)EMatchEvent::Explosion], EventCounts[(int32)EMatchEvent::Damage]);
+
+	// An empty server world with the game mode and its managers
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("ReplayEventLog"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+
+	AMyNetGameMode* GameMode = World->GetAuthGameMode<AMyNetGameMode>();
+	AExplosionManager* ExplosionManager = GameMode ? GameMode->GetExplosionManager() : nullptr;
+	ADamageAccumulator* DamageAccumulator = GameMode ? GameMode->GetDamageAccumulator() : nullptr;
+
+	if (!ExplosionManager)
+	{
+		UE_LOG(LogMyNet, Error, TEXT("ReplayEventLog: no explosion manager to replay into"));
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		return 1;
+	}
+
+	// The Blueprinted character, with the capsule the server had
+	if (AStartupPreloader* StartupPreloader = GameMode->GetStartupPreloader())
+	{
+		StartupPreloader->WaitUntilLoaded();
+	}
+
+	UClass* CharacterClass = GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf<AMyNetCharacter>() ? *GameMode->DefaultPawnClass : AMyNetCharacter::StaticClass();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	TMap<uint32, AMyNetCharacter*> Characters;
+
+	TArray<double> FrameTimes;
+	double TotalSeconds = 0.0;
+	int32 NumDamaged = 0;
+
+	for (int32 Loop = 0; Loop < NumLoops; Loop++)
+	{
+		double FrameSeconds = 0.0;
+		bool bFrameStarted = false;
+
+		for (const FMatchEvent& ReplayEvent : Events)
+		{
+			if (ReplayEvent.Type == EMatchEvent::Explosion)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				ExplosionManager->AddExplosion(ReplayEvent.Location, ReplayEvent.Radius, ReplayEvent.Damage, nullptr, nullptr);
+				FrameSeconds += FPlatformTime::Seconds() - StartTime;
+			}
+			else if (ReplayEvent.Type == EMatchEvent::Positions)
+			{
+				// The characters as the server had them at the end of the previous frame
+				for (const TPair<uint32, FVector>& Position : ReplayEvent.Positions)
+				{
+					AMyNetCharacter*& Character = Characters.FindOrAdd(Position.Key);
+					if (!Character)
+					{
+						Character = World->SpawnActor<AMyNetCharacter>(CharacterClass, Position.Value, FRotator::ZeroRotator, SpawnParameters);
+					}
+					else
+					{
+						Character->SetActorLocation(Position.Value, false, nullptr, ETeleportType::TeleportPhysics);
+					}
+				}
+
+				// Which is where the explosions of that frame were resolved
+				const double StartTime = FPlatformTime::Seconds();
+				NumDamaged += ExplosionManager->ResolveExplosions();
+				if (DamageAccumulator)
+				{
+					DamageAccumulator->Flush();
+				}
+				FrameSeconds += FPlatformTime::Seconds() - StartTime;
+
+				if (bFrameStarted)
+				{
+					FrameTimes.Add(FrameSeconds * 1000.0);
+					TotalSeconds += FrameSeconds;
+				}
+
+				bFrameStarted = true;
+				FrameSeconds = 0.0;
+			}
+		}
+
+		// The explosions of the last frame
+		NumDamaged += ExplosionManager->ResolveExplosions();
+		if (DamageAccumulator)
+		{
+			DamageAccumulator->Flush();
+		}
+	}
+
+	for (const TPair<uint32, AMyNetCharacter*>& Character : Characters)
+	{
+		if (Character.Value)
+		{
+			Character.Value->Destroy();
+		}
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	if (FrameTimes.Num() == 0)
+	{
+		UE_LOG(LogMyNet, Error, TEXT("ReplayEventLog: the log holds no frames"));
+		return 1;
+	}
+
+	FrameTimes.Sort();
+	const double MedianMs = FrameTimes[FrameTimes.Num() / 2];
+	const double P95Ms = FrameTimes[FMath::Min(FMath::FloorToInt(FrameTimes.Num() * 0.95f), FrameTimes.Num() - 1)];
+	const double MaxMs = FrameTimes.Last();
+	const double LoopSeconds = TotalSeconds / NumLoops;
+
+	UE_LOG(LogMyNet, Display, TEXT("ReplayEventLog: %d characters, %d loops, explosions and damage %.3f ms per loop (%.0fx real time)"),
+		Characters.Num(), NumLoops, 1000.0 * LoopSeconds, LoopSeconds > 0.0 ? RecordedSeconds / LoopSeconds : 0.0);
+	UE_LOG(LogMyNet, Display, TEXT("ReplayEventLog: per frame median %.4f ms, p95 %.4f ms, max %.4f ms"), MedianMs, P95Ms, MaxMs);
+	UE_LOG(LogMyNet, Display, TEXT("ReplayEventLog: %d characters damaged per loop, the server recorded %d damage applications from every source"),
+		NumDamaged / NumLoops, EventCounts[(int32)EMatchEvent::Damage]);
+
+	return 0;
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ReplayEventLogCommandlet.generated.h"
+
+/**
+* Replays a match event log recorded by a server with -EventLog, headless and as fast as it goes.
+* Characters are spawned for the recorded ones and moved to their recorded locations every frame,
+* the recorded explosions go through the explosion manager and the damage accumulator of an empty
+* server world. Logs the time the explosion and damage code took per recorded frame, so changes to
+* it can be compared on real traffic. Bomb spawns and bounces are only counted.
+*
+* UE4Editor-Cmd MyNet.uproject -run=ReplayEventLog -nullrhi -Log=Path [-Loops=3]
+*/
+UCLASS()
+class UReplayEventLogCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UReplayEventLogCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RpcBudget.h"
+#include "MyNet.h"
+
+void FRpcTokenBucket::Refill(float TimeSeconds, float Rate, float Burst)
+{
+	// Negative until first used
+	if (Tokens < 0.f)
+	{
+		Tokens = Burst;
+	}
+	else
+	{
+		Tokens = FMath::Min(Burst, Tokens + FMath::Max(0.f, TimeSeconds - LastRefillTime) * Rate);
+	}
+
+	LastRefillTime = TimeSeconds;
+}
+
+bool FRpcTokenBucket::TryConsume(float TimeSeconds, float Rate, float Burst)
+{
+	Refill(TimeSeconds, Rate, Burst);
+
+	if (Tokens < 1.f)
+	{
+		return false;
+	}
+
+	Tokens -= 1.f;
+	NumAccepted++;
+	INC_DWORD_STAT(STAT_MyNet_RpcAccepted);
+	return true;
+}
+
+void FRpcTokenBucket::MarkRejected()
+{
+	NumRejected++;
+	INC_DWORD_STAT(STAT_MyNet_RpcRejected);
+}
+
+void FRpcTokenBucket::MarkCoalesced()
+{
+	NumCoalesced++;
+	INC_DWORD_STAT(STAT_MyNet_RpcCoalesced);
+}
+
+float FRpcTokenBucket::GetTimeToNextToken(float TimeSeconds, float Rate) const
+{
+	if (Tokens < 0.f || Rate <= 0.f)
+	{
+		return 0.f;
+	}
+
+	const float Missing = 1.f - (Tokens + FMath::Max(0.f, TimeSeconds - LastRefillTime) * Rate);
+	return FMath::Max(0.f, Missing / Rate);
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** The server RPCs a connection gets a budget for */
+enum class ERpcBudget : uint8
+{
+	SpawnBomb,
+	TakeDamage,
+
+	Num
+};
+
+/**
+* Token bucket limiting how often a connection may call a server RPC.
+* It refills at Rate tokens per second up to Burst tokens, every accepted call takes one.
+* Starts full, so the first Burst calls always go through.
+*/
+struct MYNET_API FRpcTokenBucket
+{
+	/**
+	* Refills the bucket up to TimeSeconds and takes a token out of it.
+	* @return	False if the bucket is empty and the call is over budget. The caller
+	*			then either drops it with MarkRejected or folds it into a later one with MarkCoalesced
+	*/
+	bool TryConsume(float TimeSeconds, float Rate, float Burst);
+
+	void MarkRejected();
+
+	void MarkCoalesced();
+
+	/** Seconds until the bucket holds a token again, 0 if it already does */
+	float GetTimeToNextToken(float TimeSeconds, float Rate) const;
+
+	/** Calls let through */
+	int32 NumAccepted = 0;
+
+	/** Calls dropped for being over budget */
+	int32 NumRejected = 0;
+
+	/** Calls over budget that were folded into a later one */
+	int32 NumCoalesced = 0;
+
+private:
+	/** Refills the tokens up to TimeSeconds */
+	void Refill(float TimeSeconds, float Rate, float Burst);
+
+	float Tokens = -1.f;
+
+	float LastRefillTime = 0.f;
+};
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ServerTickManager.h"
+#include "MyNet.h"
+#include "MyNetGameMode.h"
+#include "MyNetIpNetDriver.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+
+AServerTickManager::AServerTickManager()
+{
+	// Works off the end of the engine frame
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Server only
+	SetReplicates(false);
+}
+
+bool AServerTickManager::IsRequested()
+{
+	return GetDefault<AServerTickManager>()->bFixedStep || FParse::Param(FCommandLine::Get(), TEXT("FixedStep"));
+}
+
+void AServerTickManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("FixedStep="), StepRate);
+	FParse::Value(CommandLine, TEXT("NetTickRate="), NetTickRate);
+
+	StepRate = FMath::Max(StepRate, 1.f);
+	StepSeconds = 1.0 / StepRate;
+
+	// The engine then ticks with the fixed DeltaTime, as fast as it can, the sleeping is done here
+	bPreviousFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(StepSeconds);
+
+	UMyNetIpNetDriver* NetDriver = Cast<UMyNetIpNetDriver>(GetWorld()->GetNetDriver());
+	if (NetDriver)
+	{
+		NetDriver->SetReplicationInterval(NetTickRate > 0.f ? 1.f / NetTickRate : 0.f);
+		ReplicationPassesAtReport = NetDriver->GetNumReplicationPasses();
+	}
+	else if (NetTickRate > 0.f)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Server tick: the game net driver isn't a MyNetIpNetDriver, replicating every step"));
+	}
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &AServerTickManager::OnEndFrame);
+
+	StepStartTime = FPlatformTime::Seconds();
+	NextStepTime = StepStartTime;
+	ReportStartTime = StepStartTime;
+	WorkMs.SetNumZeroed(FMath::CeilToInt(StepRate) * 60);
+
+	UE_LOG(LogMyNet, Log, TEXT("Server tick: fixed steps of %.2f ms, replication %s"), 1000.0 * StepSeconds,
+		NetTickRate > 0.f && NetDriver ? *FString::Printf(TEXT("at %.1f Hz"), NetTickRate) : TEXT("every step"));
+}
+
+void AServerTickManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	FApp::SetUseFixedTimeStep(bPreviousFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+
+	if (UMyNetIpNetDriver* NetDriver = Cast<UMyNetIpNetDriver>(GetWorld()->GetNetDriver()))
+	{
+		NetDriver->SetReplicationInterval(0.f);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AServerTickManager::OnEndFrame()
+{
+	const double EndTime = FPlatformTime::Seconds();
+	const float StepWorkMs = 1000.0 * (EndTime - StepStartTime);
+
+	WorkMs[NextWorkSample] = StepWorkMs;
+	NextWorkSample = (NextWorkSample + 1) % WorkMs.Num();
+	NumWorkSamples = FMath::Min(NumWorkSamples + 1, WorkMs.Num());
+
+	WorkSumMs += StepWorkMs;
+	NumSteps++;
+
+	NextStepTime += StepSeconds;
+
+	// Too late already, start the next step right away and from now on, rather than run a burst of steps to catch up
+	if (EndTime >= NextStepTime)
+	{
+		NumLateSteps++;
+		NextStepTime = EndTime;
+		StepStartTime = EndTime;
+		return;
+	}
+
+	// Sleep most of the wait, the scheduler can wake us late but never early
+	for (double Remaining = NextStepTime - EndTime; Remaining > 0.0; Remaining = NextStepTime - FPlatformTime::Seconds())
+	{
+		FPlatformProcess::SleepNoStats(Remaining > WakeMargin ? (float)(Remaining - WakeMargin) : 0.f);
+	}
+
+	const double WakeTime = FPlatformTime::Seconds();
+	const double WakeLatency = 1000.0 * (WakeTime - NextStepTime);
+
+	SleepMs += 1000.0 * (WakeTime - EndTime);
+	WakeLatencyMs += WakeLatency;
+	MaxWakeLatencyMs = FMath::Max(MaxWakeLatencyMs, WakeLatency);
+	NumSlept++;
+
+	StepStartTime = WakeTime;
+}
+
+void AServerTickManager::LogReport()
+{
+	if (NumSteps == 0)
+	{
+		UE_LOG(LogMyNet, Log, TEXT("mynet.ServerTickReport: no step since the last report"));
+		return;
+	}
+
+	const double Seconds = FPlatformTime::Seconds() - ReportStartTime;
+	const double BudgetMs = 1000.0 * StepSeconds;
+
+	// The ring starts at 0 after a report, so the first NumWorkSamples are the recorded ones either way
+	TArray<float> SortedMs(WorkMs.GetData(), NumWorkSamples);
+	SortedMs.Sort();
+	const float MedianMs = SortedMs[SortedMs.Num() / 2];
+	const float P95Ms = SortedMs[FMath::Min(FMath::FloorToInt(SortedMs.Num() * 0.95f), SortedMs.Num() - 1)];
+	const float MaxMs = SortedMs.Last();
+
+	UE_LOG(LogMyNet, Log, TEXT("mynet.ServerTickReport: %d steps of %.2f ms in %.1f seconds, %.1f steps per second, %d late"),
+		NumSteps, BudgetMs, Seconds, NumSteps / FMath::Max(Seconds, 0.001), NumLateSteps);
+	UE_LOG(LogMyNet, Log, TEXT("  work: %.1f%% of the step budget, over the last %d steps median %.3f ms, p95 %.3f ms, max %.3f ms"),
+		100.0 * WorkSumMs / (NumSteps * BudgetMs), SortedMs.Num(), MedianMs, P95Ms, MaxMs);
+	UE_LOG(LogMyNet, Log, TEXT("  sleep: %.1f%% of the time, woke up %.3f ms late on average, %.3f ms at worst"),
+		100.0 * SleepMs / FMath::Max(1000.0 * Seconds, 0.001), NumSlept > 0 ? WakeLatencyMs / NumSlept : 0.0, MaxWakeLatencyMs);
+
+	if (const UMyNetIpNetDriver* NetDriver = Cast<UMyNetIpNetDriver>(GetWorld()->GetNetDriver()))
+	{
+		const int32 NumPasses = NetDriver->GetNumReplicationPasses() - ReplicationPassesAtReport;
+		UE_LOG(LogMyNet, Log, TEXT("  replication: %d passes, %.1f per second"), NumPasses, NumPasses / FMath::Max(Seconds, 0.001));
+		ReplicationPassesAtReport = NetDriver->GetNumReplicationPasses();
+	}
+
+	NextWorkSample = 0;
+	NumWorkSamples = 0;
+	NumSteps = 0;
+	WorkSumMs = 0.0;
+	SleepMs = 0.0;
+	WakeLatencyMs = 0.0;
+	MaxWakeLatencyMs = 0.0;
+	NumSlept = 0;
+	NumLateSteps = 0;
+	ReportStartTime = FPlatformTime::Seconds();
+}
+
+static FAutoConsoleCommandWithWorld ServerTickReportCmd(
+	TEXT("mynet.ServerTickReport"),
+	TEXT("Logs the work, sleep and wake up timings of the fixed steps of the server and its replication passes, since the last report"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		AMyNetGameMode* GameMode = World->GetAuthGameMode<AMyNetGameMode>();
+		if (AServerTickManager* ServerTickManager = GameMode ? GameMode->GetServerTickManager() : nullptr)
+		{
+			ServerTickManager->LogReport();
+		}
+		else
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("mynet.ServerTickReport: only available on a dedicated server running with -FixedStep or bFixedStep"));
+		}
+	}));
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "ServerTickManager.generated.h"
+
+/**
+* Runs the dedicated server in fixed steps. The world ticks with a DeltaTime of exactly 1 / StepRate,
+* so the fuses, bounces and damage of a step are the same whatever the load, and the time left over
+* by each step is slept away until the next one starts, giving every match a predictable share of the CPU.
+* Replication runs at NetTickRate through UMyNetIpNetDriver, apart from the simulation.
+* A server that can't keep up doesn't run extra steps to catch up: its game time falls behind instead.
+* Off unless bFixedStep or -FixedStep[=Hz]. See mynet.ServerTickReport. Dedicated server only.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AServerTickManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AServerTickManager();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Returns true if the server should run in fixed steps */
+	static bool IsRequested();
+
+	/**
+	* Logs the work, sleep and wake up timings of the steps and the replication passes since the last report, then starts over.
+	* The work percentiles cover the last minute of steps at most
+	*/
+	void LogReport();
+
+protected:
+	/** Runs the server in fixed steps, same as -FixedStep */
+	UPROPERTY(Config, EditAnywhere, Category = "Fixed Step")
+	bool bFixedStep = false;
+
+	/** Simulation steps per second. Overridden by -FixedStep=Hz */
+	UPROPERTY(Config, EditAnywhere, Category = "Fixed Step")
+	float StepRate = 30.f;
+
+	/** Replication passes per second, 0 for one every step. Overridden by -NetTickRate=Hz */
+	UPROPERTY(Config, EditAnywhere, Category = "Fixed Step")
+	float NetTickRate = 0.f;
+
+	/** Last part of the wait yielded away rather than slept, covers the wake up latency of the scheduler. 0 to only sleep */
+	UPROPERTY(Config, EditAnywhere, Category = "Fixed Step")
+	float WakeMargin = 0.0002f;
+
+private:
+	/** Ends a step: sleeps until the next one is due */
+	void OnEndFrame();
+
+	FDelegateHandle EndFrameHandle;
+
+	/** The fixed step settings of the engine before, put back in EndPlay */
+	bool bPreviousFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+
+	double StepSeconds = 0.0;
+
+	/** When the next step is due, and when the current one started */
+	double NextStepTime = 0.0;
+	double StepStartTime = 0.0;
+
+	// Accounting since the last report
+
+	/** Work of the last minute of steps, a ring so that a server nobody reports on doesn't keep growing it */
+	TArray<float> WorkMs;
+	int32 NextWorkSample = 0;
+	int32 NumWorkSamples = 0;
+
+	int32 NumSteps = 0;
+	double WorkSumMs = 0.0;
+	double SleepMs = 0.0;
+	double WakeLatencyMs = 0.0;
+	double MaxWakeLatencyMs = 0.0;
+	int32 NumSlept = 0;
+	int32 NumLateSteps = 0;
+	int32 ReplicationPassesAtReport = 0;
+	double ReportStartTime = 0.0;
+};
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "StartupPreloader.h"
+#include "MyNet.h"
+#include "MyNetCharacter.h"
+#include "MyNetGameMode.h"
+#include "MyNetPlayerController.h"
+#include "Bomb.h"
+#include "BombPool.h"
+#include "LightBombManager.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "UObject/CoreNet.h"
+
+static const TCHAR* CostNames[] = { TEXT("Throw"), TEXT("PredictedThrow"), TEXT("Explosion"), TEXT("ExplosionFX") };
+static_assert(ARRAY_COUNT(CostNames) == (int32)EStartupCost::Num, "Name every cost");
+
+AStartupPreloader::AStartupPreloader()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// The server and every client run their own
+	SetReplicates(false);
+
+	PawnClass = FStringClassReference(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C"));
+}
+
+void AStartupPreloader::Start()
+{
+	StartTime = FPlatformTime::Seconds();
+
+	if (!bPreload)
+	{
+		LoadedPawnClass = PawnClass.TryLoadClass<APawn>();
+		LoadSeconds = FPlatformTime::Seconds() - StartTime;
+		SetReady();
+		return;
+	}
+
+	TArray<FStringAssetReference> Assets = PreloadAssets;
+	if (PawnClass.IsValid())
+	{
+		Assets.Add(PawnClass);
+	}
+
+	// The pawn blueprint references the bomb blueprint, which references its mesh, material and particles, so they all come along
+	LoadHandle = StreamableManager.RequestAsyncLoad(Assets, FStreamableDelegate::CreateUObject(this, &AStartupPreloader::OnAssetsLoaded));
+
+	// Nothing to load
+	if (!LoadHandle.IsValid() && !bLoaded)
+	{
+		OnAssetsLoaded();
+	}
+}
+
+void AStartupPreloader::WaitUntilLoaded()
+{
+	if (LoadHandle.IsValid() && !bLoaded)
+	{
+		LoadHandle->WaitUntilComplete();
+
+		// The completion delegate is deferred to the next tick, which a commandlet never gets to
+		OnAssetsLoaded();
+	}
+}
+
+void AStartupPreloader::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The assets were there before the world was ready to warm up with them
+	if (bLoaded && !bReady)
+	{
+		FinishStartup();
+	}
+}
+
+void AStartupPreloader::OnAssetsLoaded()
+{
+	if (bLoaded)
+	{
+		return;
+	}
+
+	bLoaded = true;
+	LoadedPawnClass = PawnClass.ResolveClass();
+	LoadSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (!LoadedPawnClass)
+	{
+		UE_LOG(LogMyNet, Warning, TEXT("Startup preloader: couldn't load the pawn class %s"), *PawnClass.ToString());
+	}
+
+	// The server streams from InitGame, the pool and the net driver only exist once the world begins play
+	if (HasActorBegunPlay())
+	{
+		FinishStartup();
+	}
+}
+
+void AStartupPreloader::FinishStartup()
+{
+	const double WarmStartTime = FPlatformTime::Seconds();
+	WarmUp();
+	WarmSeconds = FPlatformTime::Seconds() - WarmStartTime;
+
+	SetReady();
+}
+
+void AStartupPreloader::WarmUp()
+{
+	const AMyNetCharacter* DefaultCharacter = LoadedPawnClass ? Cast<AMyNetCharacter>(LoadedPawnClass->GetDefaultObject()) : nullptr;
+	const TSubclassOf<ABomb> BombClass = DefaultCharacter ? DefaultCharacter->BombActorBP : nullptr;
+
+	if (GetNetMode() != NM_Client)
+	{
+		AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>();
+		if (ABombPool* BombPool = GameMode ? GameMode->GetBombPool() : nullptr)
+		{
+			BombPool->Prewarm(BombClass);
+		}
+
+		if (GameMode)
+		{
+			WarmReplication(GameMode->PlayerControllerClass);
+			WarmReplication(GameMode->PlayerStateClass);
+			WarmReplication(GameMode->GameStateClass);
+		}
+	}
+
+	// Clients build the same layouts to receive
+	WarmReplication(LoadedPawnClass);
+	WarmReplication(BombClass);
+	WarmReplication(ALightBombManager::StaticClass());
+
+	if (!IsLeanServer())
+	{
+		WarmCosmetics(BombClass);
+	}
+}
+
+void AStartupPreloader::WarmReplication(UClass* Class)
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!Class || !NetDriver)
+	{
+		return;
+	}
+
+	// What the net driver would otherwise build when the first actor of the class gets replicated or calls an RPC
+	NetDriver->GetObjectClassRepLayout(Class);
+	NetDriver->NetCache->GetClassNetCache(Class);
+
+	for (TFieldIterator<UFunction> It(Class); It; ++It)
+	{
+		if (It->FunctionFlags & FUNC_Net)
+		{
+			NetDriver->GetFunctionRepLayout(*It);
+		}
+	}
+}
+
+void AStartupPreloader::WarmCosmetics(TSubclassOf<ABomb> BombClass)
+{
+	if (!BombClass)
+	{
+		return;
+	}
+
+	// Far below the map and destroyed in the same frame, never seen
+	const FTransform SpawnTransform(FRotator::ZeroRotator, FVector(0.f, 0.f, -100000.f));
+
+	ABomb* Bomb = GetWorld()->SpawnActorDeferred<ABomb>(BombClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Bomb)
+	{
+		return;
+	}
+
+	Bomb->SetReplicates(false);
+	Bomb->SetCosmeticProxy();
+	UGameplayStatics::FinishSpawningActor(Bomb, SpawnTransform);
+
+	Bomb->PlayExplosionFX();
+	Bomb->Destroy();
+}
+
+void AStartupPreloader::SetReady()
+{
+	bReady = true;
+	ReadySeconds = FPlatformTime::Seconds() - StartTime;
+
+	LogReport();
+
+	if (GetNetMode() != NM_Client)
+	{
+		if (AMyNetGameMode* GameMode = GetWorld()->GetAuthGameMode<AMyNetGameMode>())
+		{
+			GameMode->OnStartupReady();
+		}
+	}
+}
+
+void AStartupPreloader::AddCost(EStartupCost Cost, double Seconds)
+{
+	// The warm-up itself is in WarmSeconds
+	if (!bReady)
+	{
+		return;
+	}
+
+	FCostRecord& Record = Costs[(int32)Cost];
+	if (Record.FirstSeconds < 0.0)
+	{
+		Record.FirstSeconds = Seconds;
+	}
+	else
+	{
+		Record.LaterSeconds += Seconds;
+		Record.NumLater++;
+	}
+}
+
+void AStartupPreloader::LogReport() const
+{
+	UE_LOG(LogMyNet, Log, TEXT("mynet.StartupReport: %s, preload %s, ready after %.1f ms (loading %.1f ms, warm-up %.1f ms)"),
+		GetNetMode() == NM_Client ? TEXT("client") : TEXT("server"), bPreload ? TEXT("on") : TEXT("off"),
+		1000.0 * ReadySeconds, 1000.0 * LoadSeconds, 1000.0 * WarmSeconds);
+
+	for (int32 Cost = 0; Cost < (int32)EStartupCost::Num; Cost++)
+	{
+		const FCostRecord& Record = Costs[Cost];
+		if (Record.FirstSeconds < 0.0)
+		{
+			continue;
+		}
+
+		UE_LOG(LogMyNet, Log, TEXT("  %-15s first %8.3f ms, later %8.3f ms average (%d)"), CostNames[Cost], 1000.0 * Record.FirstSeconds,
+			Record.NumLater > 0 ? 1000.0 * Record.LaterSeconds / Record.NumLater : 0.0, Record.NumLater);
+	}
+}
+
+AStartupPreloader* AStartupPreloader::Find(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	if (AMyNetGameMode* GameMode = World->GetAuthGameMode<AMyNetGameMode>())
+	{
+		return GameMode->GetStartupPreloader();
+	}
+
+	AMyNetPlayerController* PlayerController = Cast<AMyNetPlayerController>(World->GetFirstPlayerController());
+	return PlayerController ? PlayerController->GetClientStartupPreloader() : nullptr;
+}
+
+static FAutoConsoleCommandWithWorld StartupReportCmd(
+	TEXT("mynet.StartupReport"),
+	TEXT("Logs how long the startup preloading took and what the first throws and explosions cost against the later ones. Set bPreload=False in the config to compare"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (AStartupPreloader* Preloader = AStartupPreloader::Find(World))
+		{
+			Preloader->LogReport();
+		}
+		else
+		{
+			UE_LOG(LogMyNet, Warning, TEXT("mynet.StartupReport: no startup preloader in this world"));
+		}
+	}));
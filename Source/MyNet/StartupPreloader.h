@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/StreamableManager.h"
+#include "StartupPreloader.generated.h"
+
+/** The operations that used to pay for the loading and the first instantiation of the bomb assets */
+enum class EStartupCost : uint8
+{
+	/** SpawnBomb on the server */
+	Throw,
+
+	/** The throw predicted by the owning client */
+	PredictedThrow,
+
+	/** ABomb::Explode on the server */
+	Explosion,
+
+	/** The explosion particles, wherever they get spawned */
+	ExplosionFX,
+
+	Num
+};
+
+/**
+* Startup phase of a match. Streams the pawn class and everything it references asynchronously,
+* then creates the bomb pool, the replication layouts of the replicated classes and a first bomb and
+* explosion, so none of that happens on the first throw.
+* On the server the players only get a pawn once it's done, see AMyNetGameMode::PlayerCanRestart.
+* Clients run their own, without the server parts. See mynet.StartupReport.
+*/
+UCLASS(config=Game, notplaceable)
+class MYNET_API AStartupPreloader : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AStartupPreloader();
+
+	virtual void BeginPlay() override;
+
+	/** Starts the preloading, right after the spawn. The server calls it from InitGame, so the loading overlaps the rest of the startup */
+	void Start();
+
+	/** Blocks until the streaming is done, for the benchmarks and commandlets that don't tick the world. Warms up if play has begun */
+	void WaitUntilLoaded();
+
+	/** Returns true once the assets are loaded and warmed up */
+	bool IsReady() const { return bReady; }
+
+	/** Returns the loaded pawn class, null until ready */
+	UClass* GetPawnClass() const { return LoadedPawnClass; }
+
+	/** Records the duration of an operation */
+	void AddCost(EStartupCost Cost, double Seconds);
+
+	/** Logs how long the startup took and the first and later costs of the operations */
+	void LogReport() const;
+
+	/** Returns the preloader of the server or of the local client */
+	static AStartupPreloader* Find(UWorld* World);
+
+protected:
+	/** If false the pawn class is loaded synchronously and nothing gets warmed up, the way it was. For comparisons */
+	UPROPERTY(Config, EditAnywhere, Category = Startup)
+	bool bPreload = true;
+
+	/** The pawn the players get */
+	UPROPERTY(Config, EditAnywhere, Category = Startup, meta = (MetaClass = "Pawn"))
+	FStringClassReference PawnClass;
+
+	/** Assets streamed along with the pawn class */
+	UPROPERTY(Config, EditAnywhere, Category = Startup)
+	TArray<FStringAssetReference> PreloadAssets;
+
+private:
+	/** Called when the streaming is done */
+	void OnAssetsLoaded();
+
+	/** Warms up and lets the players in */
+	void FinishStartup();
+
+	/** Creates what the first throw would create */
+	void WarmUp();
+
+	/** Builds the replication layouts and the field caches of a class and of its RPCs */
+	void WarmReplication(UClass* Class);
+
+	/** Spawns a bomb and its explosion out of sight, then destroys it */
+	void WarmCosmetics(TSubclassOf<class ABomb> BombClass);
+
+	/** Done, let the players in */
+	void SetReady();
+
+	FStreamableManager StreamableManager;
+
+	/** Keeps the streamed assets loaded */
+	TSharedPtr<FStreamableHandle> LoadHandle;
+
+	UPROPERTY(Transient)
+	UClass* LoadedPawnClass;
+
+	bool bLoaded = false;
+	bool bReady = false;
+
+	// Timings, in seconds
+
+	double StartTime = 0.0;
+	double LoadSeconds = 0.0;
+	double WarmSeconds = 0.0;
+	double ReadySeconds = 0.0;
+
+	struct FCostRecord
+	{
+		/** The first one, the one that used to hitch */
+		double FirstSeconds = -1.0;
+
+		/** The following ones */
+		double LaterSeconds = 0.0;
+		int32 NumLater = 0;
+	};
+
+	FCostRecord Costs[(int32)EStartupCost::Num];
+};
+
+/** Reports the duration of its scope to the preloader of the world */
+struct MYNET_API FStartupCostScope
+{
+	FStartupCostScope(UWorld* World, EStartupCost InCost)
+		: Preloader(AStartupPreloader::Find(World))
+		, Cost(InCost)
+		, StartTime(Preloader ? FPlatformTime::Seconds() : 0.0)
+	{
+	}
+
+	~FStartupCostScope()
+	{
+		if (Preloader)
+		{
+			Preloader->AddCost(Cost, FPlatformTime::Seconds() - StartTime);
+		}
+	}
+
+private:
+	AStartupPreloader* Preloader;
+	EStartupCost Cost;
+	double StartTime;
+};